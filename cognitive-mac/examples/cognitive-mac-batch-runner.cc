@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2025 HIAST
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include "ns3/core-module.h"
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @file
+ *
+ * Runs a sweep of a cognitive-mac scenario in parallel. The static
+ * state of the module (the message maps and the counters of the
+ * routing) is per process, so every (config, seed) point runs in its
+ * own worker process, at most --jobs of them at a time. A config is a
+ * line of command line arguments of the scenario read from --configs,
+ * every config runs with the seeds --firstRun .. --firstRun+--seeds-1
+ * passed as --RngRun.
+ *
+ * The scenario writes a CSV header and one data line to the file
+ * given by its --result argument; the runner appends the data line of
+ * every point to --output, prefixed with the config index, the seed
+ * and the arguments. The points already in
+ * --output are skipped, a point is known by its arguments and seed and
+ * not by the config index, so a sweep interrupted or with failed points
+ * resumes by running the same command again, also after the configs
+ * file was edited. A failed point is retried
+ * --retries times, its output is kept in a .log file next to --output.
+ *
+ * ./ns3 run "cognitive-mac-batch-runner --configs=sweep.txt --seeds=10 --jobs=8"
+ */
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("CognitiveMacBatchRunner");
+
+/// A (config, seed) point of the sweep
+struct Point
+{
+    uint32_t config;  //!< the index of the config line
+    uint32_t run;     //!< the RngRun of the point
+    uint32_t attempt; //!< the attempts already failed
+};
+
+/// A point running in a worker process
+struct Worker
+{
+    Point point;     //!< the point
+    std::string out; //!< the file of the standard output of the worker
+    std::string log; //!< the file of the standard error of the worker
+    std::string csv; //!< the result file written by the worker
+};
+
+static std::vector<std::string>
+SplitArgs(const std::string& line)
+{
+    std::vector<std::string> args;
+    std::istringstream stream(line);
+    std::string arg;
+    while (stream >> arg)
+    {
+        args.push_back(arg);
+    }
+    return args;
+}
+
+static std::string
+JoinArgs(const std::vector<std::string>& args)
+{
+    std::string line;
+    for (const std::string& arg : args)
+    {
+        line += (line.empty() ? "" : " ") + arg;
+    }
+    return line;
+}
+
+static std::string
+QuoteCsv(const std::string& field)
+{
+    std::string quoted = "\"";
+    for (char c : field)
+    {
+        quoted += c;
+        if (c == '"')
+        {
+            quoted += '"';
+        }
+    }
+    return quoted + "\"";
+}
+
+/**
+ * Read a field written by QuoteCsv, the stream is left after its
+ * closing quote
+ */
+static bool
+UnquoteCsv(std::istream& row, std::string& field)
+{
+    field.clear();
+    if (row.get() != '"')
+    {
+        return false;
+    }
+    int c;
+    while ((c = row.get()) != EOF)
+    {
+        if (c == '"')
+        {
+            if (row.peek() != '"')
+            {
+                return true;
+            }
+            row.get();
+        }
+        field += static_cast<char>(c);
+    }
+    return false;
+}
+
+static pid_t
+Spawn(const std::string& program,
+      const std::vector<std::string>& args,
+      const std::string& out,
+      const std::string& log)
+{
+    pid_t pid = fork();
+    if (pid != 0)
+    {
+        return pid;
+    }
+    int outFd = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int logFd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd < 0 || logFd < 0)
+    {
+        _exit(126);
+    }
+    dup2(outFd, STDOUT_FILENO);
+    dup2(logFd, STDERR_FILENO);
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(program.c_str()));
+    for (const std::string& arg : args)
+    {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    execv(program.c_str(), argv.data());
+    _exit(127);
+}
+
+/**
+ * Read the CSV header and data line of the result file written by the
+ * scenario, the data line must have as many fields as the header
+ */
+static bool
+ReadResult(const std::string& csv, std::string& header, std::string& data)
+{
+    std::ifstream file(csv);
+    return std::getline(file, header) && std::getline(file, data) && !header.empty() &&
+           std::count(header.begin(), header.end(), ',') ==
+               std::count(data.begin(), data.end(), ',');
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string program;
+    std::string scenario = "cognitive-mac-benchmark";
+    std::string configs;
+    std::string output = "cognitive-mac-batch.csv";
+    uint32_t seeds = 5;
+    uint32_t firstRun = 1;
+    uint32_t jobs = std::max<long>(1, sysconf(_SC_NPROCESSORS_ONLN));
+    uint32_t retries = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("program",
+                 "Path of the scenario program, found next to the runner if empty",
+                 program);
+    cmd.AddValue("scenario", "Name of the scenario example found next to the runner", scenario);
+    cmd.AddValue("configs", "File of the configs, one line of scenario arguments each", configs);
+    cmd.AddValue("output",
+                 "CSV file collecting the results, the points in it are skipped",
+                 output);
+    cmd.AddValue("seeds", "Number of seeds of each config", seeds);
+    cmd.AddValue("firstRun", "RngRun of the first seed", firstRun);
+    cmd.AddValue("jobs", "Number of worker processes running at the same time", jobs);
+    cmd.AddValue("retries", "Number of times a failed point is run again", retries);
+    cmd.Parse(argc, argv);
+
+    if (program.empty())
+    {
+        // the examples are built side by side, named after the example
+        program = argv[0];
+        size_t pos = program.rfind("cognitive-mac-batch-runner");
+        NS_ABORT_MSG_IF(pos == std::string::npos, "Set --program, the scenario can't be found");
+        program.replace(pos, std::string("cognitive-mac-batch-runner").size(), scenario);
+    }
+    NS_ABORT_MSG_IF(access(program.c_str(), X_OK) != 0, "Can't execute " << program);
+    jobs = std::max<uint32_t>(jobs, 1);
+
+    std::vector<std::string> configLines;
+    if (configs.empty())
+    {
+        configLines.emplace_back();
+    }
+    else
+    {
+        std::ifstream file(configs);
+        NS_ABORT_MSG_IF(!file, "Can't read " << configs);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && line[0] != '#')
+            {
+                configLines.push_back(line);
+            }
+        }
+    }
+
+    // the points of an earlier run of the same sweep, known by their arguments
+    // since the lines of the configs file may have moved since
+    std::set<std::pair<std::string, uint32_t>> done;
+    bool haveHeader = false;
+    {
+        std::ifstream file(output);
+        std::string line;
+        haveHeader = static_cast<bool>(std::getline(file, line));
+        while (std::getline(file, line))
+        {
+            uint32_t config;
+            uint32_t run;
+            char comma;
+            std::string args;
+            std::istringstream row(line);
+            if (row >> config >> comma >> run >> comma && UnquoteCsv(row, args))
+            {
+                done.insert({JoinArgs(SplitArgs(args)), run});
+            }
+        }
+    }
+
+    std::deque<Point> pending;
+    uint32_t skipped = 0;
+    for (uint32_t c = 0; c < configLines.size(); c++)
+    {
+        std::string args = JoinArgs(SplitArgs(configLines[c]));
+        for (uint32_t run = firstRun; run < firstRun + seeds; run++)
+        {
+            if (done.count({args, run}))
+            {
+                skipped++;
+            }
+            else
+            {
+                pending.push_back({c, run, 0});
+            }
+        }
+    }
+    uint32_t total = pending.size();
+    uint32_t finished = 0;
+    uint32_t failed = 0;
+    std::cerr << "running " << total << " points, " << skipped << " already in " << output
+              << ", " << jobs << " jobs" << std::endl;
+
+    std::ofstream csv(output, std::ios::app);
+    NS_ABORT_MSG_IF(!csv, "Can't write " << output);
+    std::map<pid_t, Worker> running;
+    auto start = std::chrono::steady_clock::now();
+    while (!pending.empty() || !running.empty())
+    {
+        while (!pending.empty() && running.size() < jobs)
+        {
+            Point point = pending.front();
+            pending.pop_front();
+            std::vector<std::string> args = SplitArgs(configLines[point.config]);
+            std::string name =
+                output + "." + std::to_string(point.config) + "-" + std::to_string(point.run);
+            Worker worker{point, name + ".out", name + ".log", name + ".csv"};
+            args.push_back("--RngRun=" + std::to_string(point.run));
+            args.push_back("--result=" + worker.csv);
+            std::remove(worker.csv.c_str());
+            pid_t pid = Spawn(program, args, worker.out, worker.log);
+            NS_ABORT_MSG_IF(pid < 0, "Can't fork a worker");
+            running[pid] = worker;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        auto it = running.find(pid);
+        if (it == running.end())
+        {
+            continue;
+        }
+        Worker worker = it->second;
+        running.erase(it);
+
+        std::string header;
+        std::string data;
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+                  ReadResult(worker.csv, header, data);
+        std::remove(worker.out.c_str());
+        std::remove(worker.csv.c_str());
+        if (ok)
+        {
+            if (!haveHeader)
+            {
+                csv << "config,run,args," << header << std::endl;
+                haveHeader = true;
+            }
+            csv << worker.point.config << "," << worker.point.run << ","
+                << QuoteCsv(configLines[worker.point.config]) << "," << data << std::endl;
+            std::remove(worker.log.c_str());
+        }
+        else if (worker.point.attempt < retries)
+        {
+            worker.point.attempt++;
+            pending.push_back(worker.point);
+            continue;
+        }
+        else
+        {
+            failed++;
+        }
+
+        finished++;
+        double elapsed =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double eta = elapsed / finished * (total - finished);
+        std::cerr << "[" << finished << "/" << total << "] config " << worker.point.config
+                  << " run " << worker.point.run << (ok ? " done" : " FAILED, see " + worker.log)
+                  << ", " << elapsed << " s elapsed, about " << eta << " s left" << std::endl;
+    }
+
+    std::cerr << total - failed << " points done, " << failed << " failed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
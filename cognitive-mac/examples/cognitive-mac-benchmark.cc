@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2025 HIAST
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/energy-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/cognitive-device-energy-model-helper.h"
+#include "ns3/cognitive-general-net-device.h"
+#include "ns3/cognitive-net-device-helper.h"
+#include "ns3/cognitive-routing-unite.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+/**
+ * @file
+ *
+ * Reference scenario for measuring the performance of the module.
+ * Cognitive nodes on a grid or at random positions carry constant
+ * bit rate flows between random pairs of nodes, while primary users
+ * occupy random data channels with an on/off waveform. The nodes are
+ * powered by energy sources.
+ *
+ * The scenario prints one CSV line with the simulator cost (wall
+ * time, events per second, peak resident memory) and the network
+ * result (packet delivery ratio, end-to-end latency percentiles,
+ * routing bytes and duplicate route requests), so it can be run by
+ * cognitive-mac-batch-runner and compared across changes of the
+ * module. The CSV goes to the --result file if set. With
+ * --duplicateCache=false the route requests already seen are counted
+ * but rebroadcast, which measures the flood the cache saves.
+ *
+ * The flows stop --drain seconds before the end of the simulation so
+ * the packets still in flight reach their destination and aren't
+ * counted as lost by the packet delivery ratio.
+ *
+ * The wall time covers everything the module does while running,
+ * logging included; the per-packet traces of the module are NS_LOG
+ * output, leave NS_LOG unset (or use an optimized build) when
+ * measuring.
+ */
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("CognitiveMacBenchmark");
+
+static uint32_t g_sent = 0;             //!< data packets sent by the flows
+static std::vector<double> g_latencies; //!< end-to-end latencies in ms
+
+static void
+PacketDelivered(Ptr<const Packet> packet, Time delay)
+{
+    g_latencies.push_back(delay.GetSeconds() * 1000);
+}
+
+static void
+SendPacket(Ptr<CognitiveGeneralNetDevice> source,
+           Address destination,
+           uint32_t packetSize,
+           Time interval,
+           Time stop)
+{
+    source->Send(Create<Packet>(packetSize), destination, 1);
+    g_sent++;
+    if (Simulator::Now() + interval < stop)
+    {
+        Simulator::Schedule(interval, &SendPacket, source, destination, packetSize, interval, stop);
+    }
+}
+
+static double
+Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    return sorted[std::min<size_t>(sorted.size() - 1, p * sorted.size())];
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nNodes = 49;
+    std::string layout = "grid";
+    double spacing = 40;
+    uint16_t bgSize = 4;
+    uint16_t bgCount = 2;
+    uint16_t numBins = 10;
+    uint32_t primaryUsers = 2;
+    double puDutyCycle = 0.3;
+    double puPeriod = 0.1;
+    uint32_t flows = 4;
+    uint32_t packetSize = 1000;
+    double interval = 0.05;
+    double initialEnergy = 10000;
+    double simTime = 30;
+    double trafficStart = 6;
+    double drain = 1;
+    bool duplicateCache = true;
+    std::string result;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("nodes", "Number of cognitive nodes", nNodes);
+    cmd.AddValue("layout", "Placement of the nodes, grid or random", layout);
+    cmd.AddValue("spacing", "Distance between neighboring grid nodes in m, "
+                            "the random layout covers the same area", spacing);
+    cmd.AddValue("bgSize", "Number of channels in a band group", bgSize);
+    cmd.AddValue("bgCount", "Number of band groups", bgCount);
+    cmd.AddValue("numBins", "Number of spectrum bins of a channel", numBins);
+    cmd.AddValue("primaryUsers", "Number of primary users on random data channels", primaryUsers);
+    cmd.AddValue("puDutyCycle", "Share of the period a primary user transmits", puDutyCycle);
+    cmd.AddValue("puPeriod", "Period of the on/off waveform of the primary users in s", puPeriod);
+    cmd.AddValue("flows", "Number of constant bit rate flows between random nodes", flows);
+    cmd.AddValue("packetSize", "Size of the data packets in bytes", packetSize);
+    cmd.AddValue("interval", "Interval between the packets of a flow in s", interval);
+    cmd.AddValue("initialEnergy", "Initial energy of the node sources in J", initialEnergy);
+    cmd.AddValue("simTime", "Simulation time in s", simTime);
+    cmd.AddValue("trafficStart", "Time the flows start, after clustering, in s", trafficStart);
+    cmd.AddValue("drain",
+                 "Time between the end of the flows and the end of the simulation in s",
+                 drain);
+    cmd.AddValue("duplicateCache",
+                 "Drop the route requests already seen, false rebroadcasts them",
+                 duplicateCache);
+    cmd.AddValue("result",
+                 "File the CSV result is written to, the standard output if empty",
+                 result);
+    cmd.Parse(argc, argv);
+
+    NS_ABORT_MSG_IF(nNodes < 2, "The flows need at least two nodes");
+    NS_ABORT_MSG_IF(layout != "grid" && layout != "random", "Unknown layout " << layout);
+    NS_ABORT_MSG_IF(drain < 0 || trafficStart >= simTime - drain,
+                    "The flows must start before simTime - drain");
+    Config::SetDefault("ns3::CognitiveRoutingUnite::SuppressDuplicateRequests",
+                       BooleanValue(duplicateCache));
+
+    const uint16_t numOfChannels = bgSize * bgCount + 1;
+    const double channelWidth = 1e6;
+    const uint32_t side = std::ceil(std::sqrt(nNodes));
+    const double width = (side - 1) * spacing;
+
+    NodeContainer nodes;
+    nodes.Create(nNodes);
+    NodeContainer primaryNodes;
+    primaryNodes.Create(primaryUsers);
+
+    MobilityHelper mobility;
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    if (layout == "grid")
+    {
+        Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+        for (uint32_t i = 0; i < nNodes; i++)
+        {
+            positions->Add(Vector((i % side) * spacing, (i / side) * spacing, 0));
+        }
+        mobility.SetPositionAllocator(positions);
+        mobility.Install(nodes);
+    }
+    Ptr<UniformRandomVariable> coordinate = CreateObject<UniformRandomVariable>();
+    coordinate->SetAttribute("Max", DoubleValue(width));
+    Ptr<RandomRectanglePositionAllocator> randomPositions =
+        CreateObject<RandomRectanglePositionAllocator>();
+    randomPositions->SetX(coordinate);
+    randomPositions->SetY(coordinate);
+    mobility.SetPositionAllocator(randomPositions);
+    if (layout == "random")
+    {
+        mobility.Install(nodes);
+    }
+    mobility.Install(primaryNodes);
+
+    Bands allBands;
+    for (uint32_t i = 0; i < numOfChannels * numBins; i++)
+    {
+        BandInfo band;
+        band.fl = 2.4e9 + i * channelWidth / numBins;
+        band.fh = band.fl + channelWidth / numBins;
+        band.fc = (band.fl + band.fh) / 2;
+        allBands.push_back(band);
+    }
+    Bands localBands(allBands.begin(), allBands.begin() + numBins);
+    Ptr<SpectrumModel> model = Create<SpectrumModel>(allBands);
+    Ptr<SpectrumModel> localModel = Create<SpectrumModel>(localBands);
+
+    Ptr<SpectrumValue> dataPsd = Create<SpectrumValue>(model);
+    Ptr<SpectrumValue> ctrlPsd = Create<SpectrumValue>(model);
+    Ptr<SpectrumValue> noisePsd = Create<SpectrumValue>(model);
+    for (uint32_t i = 0; i < numOfChannels * numBins; i++)
+    {
+        (*noisePsd)[i] = 4e-21;
+    }
+    for (uint32_t i = 0; i < numBins; i++)
+    {
+        (*dataPsd)[i] = 1e-8;
+        (*ctrlPsd)[(numOfChannels - 1) * numBins + i] = 1e-8;
+    }
+
+    Ptr<MultiModelSpectrumChannel> channel = CreateObject<MultiModelSpectrumChannel>();
+    channel->AddSpectrumPropagationLossModel(CreateObject<FriisSpectrumPropagationLossModel>());
+    channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+
+    CognitiveNetDeviceHelper cognitive;
+    cognitive.SetChannel(channel);
+    cognitive.SetDataTxPowerSpectralDensity(dataPsd);
+    cognitive.SetCtrlTxPowerSpectralDensity(ctrlPsd);
+    cognitive.SetNoisePowerSpectralDensity(noisePsd);
+    cognitive.SetLocalSpectrumModel(localModel);
+    cognitive.SetChannelsInfo(bgCount, bgSize, numOfChannels, numBins);
+    cognitive.SetThreshold(1e-15);
+    cognitive.SetSingleChannelSensingTime(MilliSeconds(10));
+    cognitive.SetStartTime(Seconds(0));
+    cognitive.SetStopTime(Seconds(simTime));
+    NetDeviceContainer devices = cognitive.Install(nodes);
+
+    // every primary user keeps transmitting its waveform on one data channel
+    Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable>();
+    for (uint32_t i = 0; i < primaryUsers; i++)
+    {
+        uint32_t puChannel = random->GetInteger(0, numOfChannels - 2);
+        Ptr<SpectrumValue> puPsd = Create<SpectrumValue>(model);
+        for (uint32_t j = 0; j < numBins; j++)
+        {
+            (*puPsd)[puChannel * numBins + j] = 1e-8;
+        }
+        WaveformGeneratorHelper waveform;
+        waveform.SetChannel(channel);
+        waveform.SetTxPowerSpectralDensity(puPsd);
+        waveform.SetPhyAttribute("Period", TimeValue(Seconds(puPeriod)));
+        waveform.SetPhyAttribute("DutyCycle", DoubleValue(puDutyCycle));
+        NetDeviceContainer puDevice = waveform.Install(primaryNodes.Get(i));
+        Ptr<WaveformGenerator> generator = DynamicCast<WaveformGenerator>(
+            DynamicCast<NonCommunicatingNetDevice>(puDevice.Get(0))->GetPhy());
+        Simulator::Schedule(Seconds(random->GetValue(0, puPeriod)),
+                            &WaveformGenerator::Start,
+                            generator);
+    }
+
+    BasicEnergySourceHelper energySource;
+    energySource.Set("BasicEnergySourceInitialEnergyJ", DoubleValue(initialEnergy));
+    energy::EnergySourceContainer sources = energySource.Install(nodes);
+    CognitiveDeviceEnergyModelHelper radioEnergy;
+    std::vector<Ptr<CognitiveGeneralNetDevice>> dataDevices;
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        // the data device of each node is installed first, its control device second
+        Ptr<CognitiveGeneralNetDevice> dataDev =
+            DynamicCast<CognitiveGeneralNetDevice>(devices.Get(2 * i));
+        radioEnergy.Install(dataDev, sources.Get(i));
+        dataDev->GetRoutingUnite()->TraceConnectWithoutContext("Delivered",
+                                                               MakeCallback(&PacketDelivered));
+        dataDevices.push_back(dataDev);
+    }
+
+    for (uint32_t i = 0; i < flows; i++)
+    {
+        uint32_t source = random->GetInteger(0, nNodes - 1);
+        uint32_t destination = random->GetInteger(0, nNodes - 2);
+        if (destination >= source)
+        {
+            destination++;
+        }
+        Simulator::Schedule(Seconds(trafficStart + random->GetValue(0, interval)),
+                            &SendPacket,
+                            dataDevices[source],
+                            dataDevices[destination]->GetAddress(),
+                            packetSize,
+                            Seconds(interval),
+                            Seconds(simTime - drain));
+    }
+
+    Simulator::Stop(Seconds(simTime));
+    auto start = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t events = Simulator::GetEventCount();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::sort(g_latencies.begin(), g_latencies.end());
+    double sum = 0;
+    for (double latency : g_latencies)
+    {
+        sum += latency;
+    }
+    double mean = g_latencies.empty() ? 0 : sum / g_latencies.size();
+    double pdr = g_sent == 0 ? 0 : static_cast<double>(g_latencies.size()) / g_sent;
+    std::ofstream resultFile;
+    if (!result.empty())
+    {
+        resultFile.open(result);
+        NS_ABORT_MSG_IF(!resultFile, "Can't write " << result);
+    }
+    std::ostream& out = result.empty() ? std::cout : resultFile;
+    out << "nodes,layout,channels,primary_users,flows,sim_s,drain_s,wall_s,events,events_per_s,"
+           "peak_rss_kb,sent,delivered,pdr,mean_ms,p50_ms,p95_ms,p99_ms,duplicate_cache,"
+           "routing_bytes,duplicate_requests,duplicate_rebroadcasts"
+        << std::endl;
+    out << nNodes << "," << layout << "," << numOfChannels - 1 << "," << primaryUsers << ","
+        << flows << "," << simTime << "," << drain << "," << wall << "," << events << ","
+        << (wall > 0 ? events / wall : 0) << "," << usage.ru_maxrss << "," << g_sent << ","
+        << g_latencies.size() << "," << pdr << "," << mean << ","
+        << Percentile(g_latencies, 0.5) << "," << Percentile(g_latencies, 0.95) << ","
+        << Percentile(g_latencies, 0.99) << "," << duplicateCache << ","
+        << CognitiveRoutingUnite::NumRoutingBytes() << ","
+        << CognitiveRoutingUnite::NumDuplicateRequests() << ","
+        << CognitiveRoutingUnite::NumDuplicateRebroadcasts() << std::endl;
+
+    Simulator::Destroy();
+    return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2025 HIAST
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/energy-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/cognitive-device-energy-model-helper.h"
+#include "ns3/cognitive-general-net-device.h"
+#include "ns3/cognitive-net-device-helper.h"
+#include "ns3/cognitive-routing-unite.h"
+
+#include <fstream>
+#include <iostream>
+
+/**
+ * @file
+ *
+ * Grid of cognitive nodes started together, running only the
+ * clustering on the control channel. The control timers are
+ * either desynchronized by a random phase and jitter or run in
+ * lock-step (--desync=false), and the share of the control
+ * receptions corrupted by collisions is printed as one CSV line
+ * so the two runs can be compared.
+ */
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("CognitiveMacControlDesync");
+
+static uint32_t g_rxOk = 0;    //!< control frames received
+static uint32_t g_rxError = 0; //!< control frames corrupted
+
+static void
+ControlRxOk(Ptr<const Packet> packet)
+{
+    g_rxOk++;
+}
+
+static void
+ControlRxError(Ptr<const Packet> packet)
+{
+    g_rxError++;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t side = 5;
+    double spacing = 40;
+    double simTime = 30;
+    bool desync = true;
+    std::string result;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("side", "Number of nodes on a side of the grid", side);
+    cmd.AddValue("spacing", "Distance between neighboring nodes in m", spacing);
+    cmd.AddValue("simTime", "Simulation time in s", simTime);
+    cmd.AddValue("desync", "Desynchronize the control timers of the nodes", desync);
+    cmd.AddValue("result",
+                 "File the CSV result is written to, the standard output if empty",
+                 result);
+    cmd.Parse(argc, argv);
+
+    if (!desync)
+    {
+        Config::SetDefault("ns3::CognitiveControlApplication::StartPhaseOffset",
+                           TimeValue(Seconds(0)));
+        Config::SetDefault("ns3::CognitiveControlApplication::PeriodJitter",
+                           TimeValue(Seconds(0)));
+        Config::SetDefault("ns3::CognitiveControlApplication::BroadcastJitter",
+                           TimeValue(Seconds(0)));
+    }
+
+    const uint16_t bgSize = 4;
+    const uint16_t bgCount = 2;
+    const uint16_t numOfChannels = bgSize * bgCount + 1;
+    const uint16_t numBins = 10;
+    const double channelWidth = 1e6;
+
+    NodeContainer nodes;
+    nodes.Create(side * side);
+
+    Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+    for (uint32_t i = 0; i < side * side; i++)
+    {
+        positions->Add(Vector((i % side) * spacing, (i / side) * spacing, 0));
+    }
+    MobilityHelper mobility;
+    mobility.SetPositionAllocator(positions);
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.Install(nodes);
+
+    Bands allBands;
+    for (uint32_t i = 0; i < numOfChannels * numBins; i++)
+    {
+        BandInfo band;
+        band.fl = 2.4e9 + i * channelWidth / numBins;
+        band.fh = band.fl + channelWidth / numBins;
+        band.fc = (band.fl + band.fh) / 2;
+        allBands.push_back(band);
+    }
+    Bands localBands(allBands.begin(), allBands.begin() + numBins);
+    Ptr<SpectrumModel> model = Create<SpectrumModel>(allBands);
+    Ptr<SpectrumModel> localModel = Create<SpectrumModel>(localBands);
+
+    Ptr<SpectrumValue> dataPsd = Create<SpectrumValue>(model);
+    Ptr<SpectrumValue> ctrlPsd = Create<SpectrumValue>(model);
+    Ptr<SpectrumValue> noisePsd = Create<SpectrumValue>(model);
+    for (uint32_t i = 0; i < numOfChannels * numBins; i++)
+    {
+        (*noisePsd)[i] = 4e-21;
+    }
+    for (uint32_t i = 0; i < numBins; i++)
+    {
+        (*dataPsd)[i] = 1e-8;
+        (*ctrlPsd)[(numOfChannels - 1) * numBins + i] = 1e-8;
+    }
+
+    Ptr<MultiModelSpectrumChannel> channel = CreateObject<MultiModelSpectrumChannel>();
+    channel->AddSpectrumPropagationLossModel(CreateObject<FriisSpectrumPropagationLossModel>());
+    channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+
+    CognitiveNetDeviceHelper cognitive;
+    cognitive.SetChannel(channel);
+    cognitive.SetDataTxPowerSpectralDensity(dataPsd);
+    cognitive.SetCtrlTxPowerSpectralDensity(ctrlPsd);
+    cognitive.SetNoisePowerSpectralDensity(noisePsd);
+    cognitive.SetLocalSpectrumModel(localModel);
+    cognitive.SetChannelsInfo(bgCount, bgSize, numOfChannels, numBins);
+    cognitive.SetThreshold(1e-15);
+    cognitive.SetSingleChannelSensingTime(MilliSeconds(10));
+    cognitive.SetStartTime(Seconds(0));
+    cognitive.SetStopTime(Seconds(simTime));
+    NetDeviceContainer devices = cognitive.Install(nodes);
+    // the runs differ by --RngRun only
+    cognitive.AssignStreams(devices, 0);
+
+    BasicEnergySourceHelper energySource;
+    energySource.Set("BasicEnergySourceInitialEnergyJ", DoubleValue(10000));
+    energy::EnergySourceContainer sources = energySource.Install(nodes);
+    CognitiveDeviceEnergyModelHelper radioEnergy;
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        // the data device of each node is installed first, its control device second
+        Ptr<CognitiveGeneralNetDevice> dataDev =
+            DynamicCast<CognitiveGeneralNetDevice>(devices.Get(2 * i));
+        Ptr<CognitiveGeneralNetDevice> controlDev =
+            DynamicCast<CognitiveGeneralNetDevice>(devices.Get(2 * i + 1));
+        radioEnergy.Install(dataDev, sources.Get(i));
+        controlDev->GetPhy()->TraceConnectWithoutContext("RxEndOk", MakeCallback(&ControlRxOk));
+        controlDev->GetPhy()->TraceConnectWithoutContext("RxEndError",
+                                                         MakeCallback(&ControlRxError));
+    }
+
+    Simulator::Stop(Seconds(simTime));
+    Simulator::Run();
+
+    uint32_t total = g_rxOk + g_rxError;
+    double collisionRate = total == 0 ? 0 : static_cast<double>(g_rxError) / total;
+    std::ofstream resultFile;
+    if (!result.empty())
+    {
+        resultFile.open(result);
+        NS_ABORT_MSG_IF(!resultFile, "Can't write " << result);
+    }
+    std::ostream& out = result.empty() ? std::cout : resultFile;
+    out << "desync,rx_ok,rx_error,collision_rate" << std::endl;
+    out << desync << "," << g_rxOk << "," << g_rxError << "," << collisionRate << std::endl;
+
+    Simulator::Destroy();
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2025 HIAST
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/energy-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/cognitive-device-energy-model-helper.h"
+#include "ns3/cognitive-general-net-device.h"
+#include "ns3/cognitive-net-device-helper.h"
+#include "ns3/cognitive-routing-unite.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+/**
+ * @file
+ *
+ * Grid of cognitive nodes carrying constant bit rate flows between
+ * the corners of the grid. The routes are chosen either by the
+ * analytical link delay or by the link delay measured at the MAC
+ * (--metric), and the end-to-end latencies of the delivered packets
+ * are printed as one CSV line so the two runs can be compared.
+ */
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("CognitiveMacLinkDelay");
+
+static std::vector<double> g_latencies; //!< end-to-end latencies in ms
+
+static void
+PacketDelivered(Ptr<const Packet> packet, Time delay)
+{
+    g_latencies.push_back(delay.GetSeconds() * 1000);
+}
+
+static void
+SendPacket(Ptr<CognitiveGeneralNetDevice> source,
+           Address destination,
+           uint32_t packetSize,
+           Time interval,
+           Time stop)
+{
+    source->Send(Create<Packet>(packetSize), destination, 1);
+    if (Simulator::Now() + interval < stop)
+    {
+        Simulator::Schedule(interval, &SendPacket, source, destination, packetSize, interval, stop);
+    }
+}
+
+static double
+Percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    return sorted[std::min<size_t>(sorted.size() - 1, p * sorted.size())];
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t side = 5;
+    double spacing = 40;
+    uint32_t packetSize = 1000;
+    double interval = 0.05;
+    double simTime = 30;
+    double trafficStart = 6;
+    std::string metric = "Measured";
+    std::string result;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("side", "Number of nodes on a side of the grid", side);
+    cmd.AddValue("spacing", "Distance between neighboring nodes in m", spacing);
+    cmd.AddValue("packetSize", "Size of the data packets in bytes", packetSize);
+    cmd.AddValue("interval", "Interval between the packets of a flow in s", interval);
+    cmd.AddValue("simTime", "Simulation time in s", simTime);
+    cmd.AddValue("trafficStart", "Time the flows start, after clustering, in s", trafficStart);
+    cmd.AddValue("metric", "Link delay metric of the routing, Analytical or Measured", metric);
+    cmd.AddValue("result",
+                 "File the CSV result is written to, the standard output if empty",
+                 result);
+    cmd.Parse(argc, argv);
+
+    Config::SetDefault("ns3::CognitiveRoutingUnite::LinkDelayMetric", StringValue(metric));
+
+    const uint16_t bgSize = 4;
+    const uint16_t bgCount = 2;
+    const uint16_t numOfChannels = bgSize * bgCount + 1;
+    const uint16_t numBins = 10;
+    const double channelWidth = 1e6;
+
+    NodeContainer nodes;
+    nodes.Create(side * side);
+
+    Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+    for (uint32_t i = 0; i < side * side; i++)
+    {
+        positions->Add(Vector((i % side) * spacing, (i / side) * spacing, 0));
+    }
+    MobilityHelper mobility;
+    mobility.SetPositionAllocator(positions);
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.Install(nodes);
+
+    Bands allBands;
+    for (uint32_t i = 0; i < numOfChannels * numBins; i++)
+    {
+        BandInfo band;
+        band.fl = 2.4e9 + i * channelWidth / numBins;
+        band.fh = band.fl + channelWidth / numBins;
+        band.fc = (band.fl + band.fh) / 2;
+        allBands.push_back(band);
+    }
+    Bands localBands(allBands.begin(), allBands.begin() + numBins);
+    Ptr<SpectrumModel> model = Create<SpectrumModel>(allBands);
+    Ptr<SpectrumModel> localModel = Create<SpectrumModel>(localBands);
+
+    Ptr<SpectrumValue> dataPsd = Create<SpectrumValue>(model);
+    Ptr<SpectrumValue> ctrlPsd = Create<SpectrumValue>(model);
+    Ptr<SpectrumValue> noisePsd = Create<SpectrumValue>(model);
+    for (uint32_t i = 0; i < numOfChannels * numBins; i++)
+    {
+        (*noisePsd)[i] = 4e-21;
+    }
+    for (uint32_t i = 0; i < numBins; i++)
+    {
+        (*dataPsd)[i] = 1e-8;
+        (*ctrlPsd)[(numOfChannels - 1) * numBins + i] = 1e-8;
+    }
+
+    Ptr<MultiModelSpectrumChannel> channel = CreateObject<MultiModelSpectrumChannel>();
+    channel->AddSpectrumPropagationLossModel(CreateObject<FriisSpectrumPropagationLossModel>());
+    channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+
+    CognitiveNetDeviceHelper cognitive;
+    cognitive.SetChannel(channel);
+    cognitive.SetDataTxPowerSpectralDensity(dataPsd);
+    cognitive.SetCtrlTxPowerSpectralDensity(ctrlPsd);
+    cognitive.SetNoisePowerSpectralDensity(noisePsd);
+    cognitive.SetLocalSpectrumModel(localModel);
+    cognitive.SetChannelsInfo(bgCount, bgSize, numOfChannels, numBins);
+    cognitive.SetThreshold(1e-15);
+    cognitive.SetSingleChannelSensingTime(MilliSeconds(10));
+    cognitive.SetStartTime(Seconds(0));
+    cognitive.SetStopTime(Seconds(simTime));
+    NetDeviceContainer devices = cognitive.Install(nodes);
+
+    BasicEnergySourceHelper energySource;
+    energySource.Set("BasicEnergySourceInitialEnergyJ", DoubleValue(10000));
+    energy::EnergySourceContainer sources = energySource.Install(nodes);
+    CognitiveDeviceEnergyModelHelper radioEnergy;
+    std::vector<Ptr<CognitiveGeneralNetDevice>> dataDevices;
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        // the data device of each node is installed first, its control device second
+        Ptr<CognitiveGeneralNetDevice> dataDev =
+            DynamicCast<CognitiveGeneralNetDevice>(devices.Get(2 * i));
+        radioEnergy.Install(dataDev, sources.Get(i));
+        dataDev->GetRoutingUnite()->TraceConnectWithoutContext("Delivered",
+                                                               MakeCallback(&PacketDelivered));
+        dataDevices.push_back(dataDev);
+    }
+
+    // two flows crossing the grid between its opposite corners
+    uint32_t last = side * side - 1;
+    Simulator::Schedule(Seconds(trafficStart), &SendPacket, dataDevices[0],
+                        dataDevices[last]->GetAddress(), packetSize, Seconds(interval),
+                        Seconds(simTime));
+    Simulator::Schedule(Seconds(trafficStart), &SendPacket, dataDevices[side - 1],
+                        dataDevices[last - side + 1]->GetAddress(), packetSize,
+                        Seconds(interval), Seconds(simTime));
+
+    Simulator::Stop(Seconds(simTime));
+    Simulator::Run();
+
+    std::sort(g_latencies.begin(), g_latencies.end());
+    double sum = 0;
+    for (double latency : g_latencies)
+    {
+        sum += latency;
+    }
+    double mean = g_latencies.empty() ? 0 : sum / g_latencies.size();
+    std::ofstream resultFile;
+    if (!result.empty())
+    {
+        resultFile.open(result);
+        NS_ABORT_MSG_IF(!resultFile, "Can't write " << result);
+    }
+    std::ostream& out = result.empty() ? std::cout : resultFile;
+    out << "metric,delivered,mean_ms,p50_ms,p90_ms,p99_ms" << std::endl;
+    out << metric << "," << g_latencies.size() << "," << mean << ","
+        << Percentile(g_latencies, 0.5) << "," << Percentile(g_latencies, 0.9) << ","
+        << Percentile(g_latencies, 0.99) << std::endl;
+
+    CognitiveRoutingUnite::GetSimulationResults();
+    Simulator::Destroy();
+    return 0;
+}
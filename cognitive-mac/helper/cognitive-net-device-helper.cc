@@ -22,6 +22,8 @@
 #include "ns3/spectrum-channel.h"
 #include "ns3/spectrum-propagation-loss-model.h"
 
+#include <set>
+
 namespace ns3
 {
 
@@ -168,10 +170,6 @@ CognitiveNetDeviceHelper::Install(NodeContainer c) const
 
         datadev->SetAddress(Mac48Address::Allocate());
         controldev->SetAddress(datadev->GetAddress());
-        std::queue<Ptr<MacDcfFrame>> *q = new std::queue<Ptr<MacDcfFrame>>();
-        std::queue<Ptr<MacDcfFrame>> *f = new std::queue<Ptr<MacDcfFrame>>();
-        datadev->SetQueue(q);
-        controldev->SetQueue(f);   
 
         ctrlApp->SetAddress(datadev->GetAddress());
         ctrlSpect->SetChannels(m_bgSize,m_bgCount);
@@ -192,6 +190,16 @@ CognitiveNetDeviceHelper::Install(NodeContainer c) const
             MakeCallback(&CognitiveControlApplication::ReceiveControlMsg,ctrlApp));
         routingUnite->SetNumberOfNeighboringNodesCallback(
             MakeCallback(&CognitiveControlApplication::GetNumberOfNeighbors,ctrlApp));
+        routingUnite->SetIsClusterMemberCallback(
+            MakeCallback(&CognitiveControlApplication::IsClusterMember,ctrlApp));
+        routingUnite->SetClusterMembersCallback(
+            MakeCallback(&CognitiveControlApplication::GetClusterMembers,ctrlApp));
+        routingUnite->SetLinkStatsCallback(
+            MakeCallback(&CognitiveGeneralNetDevice::GetLinkStats,datadev));
+        datadev->SetLinkFailureCallback(
+            MakeCallback(&CognitiveRoutingUnite::NotifyLinkFailure,routingUnite));
+        controldev->SetLinkFailureCallback(
+            MakeCallback(&CognitiveRoutingUnite::NotifyLinkFailure,routingUnite));
 
 
         datadev->SetDeviceKind(true);
@@ -208,6 +216,8 @@ CognitiveNetDeviceHelper::Install(NodeContainer c) const
             MakeCallback(&CognitiveGeneralNetDevice::GetReamainingEnergy,datadev));
         ctrlApp->SetSetCommonDataChannelsCallback(
             MakeCallback(&CognitiveGeneralNetDevice::SetClusterInfo,datadev));
+        ctrlApp->SetSetTdmaScheduleCallback(
+            MakeCallback(&CognitiveGeneralNetDevice::SetTdmaSchedule,datadev));
             
         // note that we could have used a SpectrumPhyHelper here, but
         // given that it is straightforward to handle the configuration
@@ -338,4 +348,36 @@ CognitiveNetDeviceHelper::Install(std::string nodeName) const
     return Install(node);
 }
 
+int64_t
+
+CognitiveNetDeviceHelper::AssignStreams(NetDeviceContainer c, int64_t stream)
+{
+    int64_t currentStream = stream;
+    std::set<uint32_t> nodes;
+    for (NetDeviceContainer::Iterator i = c.Begin(); i != c.End(); ++i)
+    {
+        Ptr<CognitiveGeneralNetDevice> dev = DynamicCast<CognitiveGeneralNetDevice>(*i);
+        if (!dev)
+        {
+            continue;
+        }
+        currentStream += dev->AssignStreams(currentStream);
+        // the data and control devices of a node share its control application
+        Ptr<Node> node = dev->GetNode();
+        if (nodes.insert(node->GetId()).second)
+        {
+            for (uint32_t j = 0; j < node->GetNApplications(); j++)
+            {
+                Ptr<CognitiveControlApplication> app =
+                    DynamicCast<CognitiveControlApplication>(node->GetApplication(j));
+                if (app)
+                {
+                    currentStream += app->AssignStreams(currentStream);
+                }
+            }
+        }
+    }
+    return (currentStream - stream);
+}
+
 } // namespace ns3
\ No newline at end of file
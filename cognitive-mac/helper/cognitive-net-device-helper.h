@@ -146,6 +146,15 @@ class CognitiveNetDeviceHelper
      */
     NetDeviceContainer Install(std::string nodeName) const;
 
+    /**
+     * Assign a fixed random variable stream to the random variables
+     * of the devices and of the control applications of their nodes
+     * @param c the devices installed by this helper
+     * @param stream the first stream index
+     * @return the number of stream indices assigned
+     */
+    int64_t AssignStreams(NetDeviceContainer c, int64_t stream);
+
 
   protected:
     ObjectFactory m_phy;                //!< Object factory for the phy objects
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#include "cognitive-channel-index.h"
+
+#include <ns3/assert.h>
+
+namespace ns3
+{
+
+CognitiveChannelIndex::CognitiveChannelIndex()
+    : m_dense(false)
+{
+
+}
+
+void
+
+CognitiveChannelIndex::SetDense(bool dense)
+{
+    if(dense==m_dense)
+    {
+        return;
+    }
+    m_dense = dense;
+    if(m_dense)
+    {
+        m_denseCount.assign(MaxDenseChannels,0);
+        for(auto it = m_sparseCount.begin() ; it != m_sparseCount.end() ;)
+        {
+            if(it->first < MaxDenseChannels)
+            {
+                m_denseCount[it->first] = it->second;
+                it = m_sparseCount.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    else
+    {
+        for(uint16_t i = 0 ; i < m_denseCount.size() ; i++)
+        {
+            if(m_denseCount[i])
+            {
+                m_sparseCount[i] = m_denseCount[i];
+            }
+        }
+        m_denseCount.clear();
+    }
+}
+
+void
+
+CognitiveChannelIndex::AddChannels(const std::set<uint16_t>& channels)
+{
+    for(auto& i : channels)
+    {
+        if(m_dense && i < MaxDenseChannels)
+        {
+            m_denseCount[i]++;
+        }
+        else
+        {
+            m_sparseCount[i]++;
+        }
+    }
+}
+
+void
+
+CognitiveChannelIndex::RemoveChannels(const std::set<uint16_t>& channels)
+{
+    for(auto& i : channels)
+    {
+        if(m_dense && i < MaxDenseChannels)
+        {
+            NS_ASSERT_MSG(m_denseCount[i]>0,"removing a channel which wasn't added");
+            m_denseCount[i]--;
+        }
+        else
+        {
+            auto it = m_sparseCount.find(i);
+            NS_ASSERT_MSG(it!=m_sparseCount.end(),"removing a channel which wasn't added");
+            if(--it->second==0)
+            {
+                m_sparseCount.erase(it);
+            }
+        }
+    }
+}
+
+uint16_t
+
+CognitiveChannelIndex::GetCount(uint16_t channel) const
+{
+    if(m_dense && channel < MaxDenseChannels)
+    {
+        return m_denseCount[channel];
+    }
+    auto it = m_sparseCount.find(channel);
+    return it==m_sparseCount.end() ? 0 : it->second;
+}
+
+double
+
+CognitiveChannelIndex::ChannelFitness(const std::map<uint16_t,double>& quality,
+                                      const MacKeyMap<std::pair<uint16_t,uint16_t>>& clusters) const
+{
+    double CF = 0.0;
+    if(m_dense)
+    {
+        std::bitset<MaxDenseChannels> used;
+        std::set<uint16_t> usedHigh;
+        for(auto& i : clusters)
+        {
+            if(i.second.first < MaxDenseChannels)
+            {
+                used.set(i.second.first);
+            }
+            else
+            {
+                usedHigh.insert(i.second.first);
+            }
+        }
+        for(auto& i : quality)
+        {
+            if(i.first < MaxDenseChannels ? used.test(i.first) : usedHigh.count(i.first))
+            {
+                continue;
+            }
+            CF += i.second*GetCount(i.first);
+        }
+    }
+    else
+    {
+        std::set<uint16_t> used;
+        for(auto& i : clusters)
+        {
+            used.insert(i.second.first);
+        }
+        for(auto& i : quality)
+        {
+            if(used.count(i.first))
+            {
+                continue;
+            }
+            CF += i.second*GetCount(i.first);
+        }
+    }
+    return CF;
+}
+
+void
+
+CognitiveChannelIndex::Clear()
+{
+    m_sparseCount.clear();
+    if(m_dense)
+    {
+        m_denseCount.assign(MaxDenseChannels,0);
+    }
+}
+
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#ifndef COGNITIVE_CHANNEL_INDEX
+#define COGNITIVE_CHANNEL_INDEX
+
+#include "cognitive-mac-key.h"
+
+#include <ns3/address.h>
+
+#include <bitset>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * this class keeps for every channel the number
+ * of neighboring nodes having it available, so
+ * the channel fitness is a single pass over the
+ * effective available channels
+ */
+
+class CognitiveChannelIndex
+{
+    public:
+      static const uint16_t MaxDenseChannels = 1024; //!< channels below this index use the dense storage
+
+      CognitiveChannelIndex();
+
+      /**
+       * @brief use a dense vector and bitsets
+       * for the channels below MaxDenseChannels
+       * instead of a sorted map
+       * @param dense true for the dense storage
+       */
+      void SetDense(bool dense);
+
+      /**
+       * @brief add the available channels
+       * of a neighboring node
+       * @param channels the available channels
+       */
+      void AddChannels(const std::set<uint16_t>& channels);
+
+      /**
+       * @brief remove the available channels
+       * of a neighboring node
+       * @param channels the available channels
+       */
+      void RemoveChannels(const std::set<uint16_t>& channels);
+
+      /**
+       * @brief get the number of neighboring
+       * nodes having the channel available
+       * @param channel the index of the channel
+       * @return the number of neighbors
+       */
+      uint16_t GetCount(uint16_t channel) const;
+
+      /**
+       * @brief calculate the channel fitness over
+       * the effective available channels, the available
+       * channels minus the CADCs of the neighboring clusters
+       * @param quality the available channels and their Q values
+       * @param clusters the neighboring clusters and their CADC,CBDC
+       * @return the channel fitness
+       */
+      double ChannelFitness(const std::map<uint16_t,double>& quality,
+                            const MacKeyMap<std::pair<uint16_t,uint16_t>>& clusters) const;
+
+      /**
+       * @brief remove all the counts
+       */
+      void Clear();
+
+    private:
+
+      bool m_dense;                                 //!< true if the dense storage is used
+      std::vector<uint16_t> m_denseCount;           //!< the counts of the channels below MaxDenseChannels
+      std::map<uint16_t,uint16_t> m_sparseCount;    //!< the counts of the other channels
+};
+
+}
+
+#endif // COGNITIVE_CHANNEL_INDEX
@@ -7,6 +7,14 @@
 
 #include "cognitive-control-application.h"
 
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/nstime.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
 namespace ns3
 {
 
@@ -17,18 +25,35 @@ NS_OBJECT_ENSURE_REGISTERED(CognitiveControlApplication);
 CognitiveControlApplication::CognitiveControlApplication():
       m_spectrumControlModule(nullptr),
       m_resenseTime(Seconds(600)),m_ctrlMsgDuration(Seconds(10)),
-      m_SendNCCIPeriod(Seconds(5)),m_updateTables(Seconds(0.1)),
+      m_SendNCCIPeriod(Seconds(5)),
       m_initialtime(Seconds(2)),m_clusterAge(Seconds(1)),
+      m_tdmaSlot(MilliSeconds(5)),m_schedulePeriod(Seconds(1)),
+      m_broadcastJitter(MilliSeconds(20)),m_implicitAckGuard(MilliSeconds(20)),
+      m_startPhaseOffset(MilliSeconds(50)),m_periodJitter(MilliSeconds(10)),
+      m_discoveryTimeout(MilliSeconds(300)),m_phaseTimeout(MilliSeconds(100)),
+      m_minTenure(Seconds(10)),m_clusterSince(Seconds(0)),
+      m_lastNcciTime(Seconds(-1)),m_clusterState(IDLE),
       m_CADC(-1),m_CBDC(-1),m_CHrequests(0),
       m_NNmax(20),m_NRCmax(10),
+      m_ncciEpoch(0),m_ncciSinceFull(0),
+      m_ncciFullRefreshInterval(4),
+      m_ncciRepairs(0),m_maxNcciRepairs(1),
+      m_clusterHeadChanges(0),
       m_beta1(0.25),m_beta2(0.25),
       m_beta3(0.25),m_beta4(0.25),
+      m_vMargin(0.05),
       m_CFmax(20),m_Emax(15000),m_Etta(0.5),
-      m_curEnergy(150),m_ImClusterHead(false)
+      m_curEnergy(150),m_ImClusterHead(false),
+      m_oneHopClustDirty(false),
+      m_denseChannelIndex(true),
+      m_tdma(false),
+      m_implicitAck(false),
+      m_forceFullNcci(false),
+      m_clusterFormed(false)
 {
-      m_availableChannelQvalues = new std::map<uint16_t,double>();
-      m_neighborsInfo = new std::map<Address,std::set<uint16_t>>();
-      m_neighborCluster = new std::map<Address,std::pair<uint16_t,uint16_t>>();
+      m_jitter = CreateObject<UniformRandomVariable>();
+      m_tables = Create<NcciTables>();
+      m_tables->channelIndex.SetDense(m_denseChannelIndex);
 }
 
 CognitiveControlApplication::~CognitiveControlApplication()
@@ -44,7 +69,111 @@ CognitiveControlApplication::GetTypeId()
         TypeId("ns3::CognitiveControlApplication")
             .SetParent<Application>()
             .SetGroupName("Network")
-            .AddConstructor<CognitiveControlApplication>();
+            .AddConstructor<CognitiveControlApplication>()
+            .AddAttribute("DenseChannelIndex",
+                          "Count the neighbors of the channels below 1024 in dense bitsets "
+                          "instead of a sorted map",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&CognitiveControlApplication::SetDenseChannelIndex,
+                                              &CognitiveControlApplication::GetDenseChannelIndex),
+                          MakeBooleanChecker())
+            .AddAttribute("NcciFullRefreshInterval",
+                          "The number of delta NCCI messages sent between two full refreshes, "
+                          "0 sends every NCCI as a full refresh, a neighbor that missed a full "
+                          "refresh keeps the last tables of this node until the next one",
+                          UintegerValue(4),
+                          MakeUintegerAccessor(&CognitiveControlApplication::m_ncciFullRefreshInterval),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("TdmaMode",
+                          "The cluster heads give every member a slot of a TDMA superframe "
+                          "on the common active data channel instead of letting them contend",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&CognitiveControlApplication::m_tdma),
+                          MakeBooleanChecker())
+            .AddAttribute("TdmaSlot",
+                          "The duration of a slot of the TDMA superframe",
+                          TimeValue(MilliSeconds(5)),
+                          MakeTimeAccessor(&CognitiveControlApplication::m_tdmaSlot),
+                          MakeTimeChecker())
+            .AddAttribute("TdmaSchedulePeriod",
+                          "The period the cluster heads announce their TDMA schedule",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&CognitiveControlApplication::m_schedulePeriod),
+                          MakeTimeChecker())
+            .AddAttribute("BroadcastJitter",
+                          "The maximum random delay of the NCCI and CH_ANM broadcasts, it "
+                          "separates the broadcasts the timers of the neighbors still send "
+                          "together, the StartPhaseOffset spreads the periods. The CH_ANMs "
+                          "of a round must arrive within the PhaseTimeout so it must stay "
+                          "below it, 20 ms hold tens of control frames at 1 Mbps",
+                          TimeValue(MilliSeconds(20)),
+                          MakeTimeAccessor(&CognitiveControlApplication::m_broadcastJitter),
+                          MakeTimeChecker())
+            .AddAttribute("StartPhaseOffset",
+                          "The maximum random offset of the control timers of a node, "
+                          "it desynchronizes the nodes started together",
+                          TimeValue(MilliSeconds(50)),
+                          MakeTimeAccessor(&CognitiveControlApplication::m_startPhaseOffset),
+                          MakeTimeChecker())
+            .AddAttribute("PeriodJitter",
+                          "The maximum random delay added to each period of the control timers, "
+                          "it doesn't accumulate over the periods",
+                          TimeValue(MilliSeconds(10)),
+                          MakeTimeAccessor(&CognitiveControlApplication::m_periodJitter),
+                          MakeTimeChecker())
+            .AddAttribute("DiscoveryTimeout",
+                          "The maximum time the cluster formation waits for the neighbors "
+                          "to list this node in their NCCIs",
+                          TimeValue(MilliSeconds(300)),
+                          MakeTimeAccessor(&CognitiveControlApplication::m_discoveryTimeout),
+                          MakeTimeChecker())
+            .AddAttribute("PhaseTimeout",
+                          "The maximum time the cluster formation waits for the CH_REQs "
+                          "and then for the CH_ANMs of a round",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&CognitiveControlApplication::m_phaseTimeout),
+                          MakeTimeChecker())
+            .AddAttribute("VMargin",
+                          "The V value a new cluster head must exceed the current one by "
+                          "before this node switches to it",
+                          DoubleValue(0.05),
+                          MakeDoubleAccessor(&CognitiveControlApplication::m_vMargin),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("MinClusterTenure",
+                          "The time a node stays with its cluster head, and a cluster head keeps "
+                          "its role and channels, before it may switch",
+                          TimeValue(Seconds(10)),
+                          MakeTimeAccessor(&CognitiveControlApplication::m_minTenure),
+                          MakeTimeChecker())
+            .AddAttribute("ImplicitAck",
+                          "A NCCI of a neighbor sent after the NCCI of this node acknowledges it "
+                          "if it lists this node, otherwise a repair NCCI is sent",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&CognitiveControlApplication::m_implicitAck),
+                          MakeBooleanChecker())
+            .AddAttribute("ImplicitAckGuard",
+                          "The time the NCCI of this node needs to reach the neighbors after "
+                          "its broadcast, a neighbor NCCI created earlier can't acknowledge it",
+                          TimeValue(MilliSeconds(20)),
+                          MakeTimeAccessor(&CognitiveControlApplication::m_implicitAckGuard),
+                          MakeTimeChecker())
+            .AddAttribute("MaxNcciRepairs",
+                          "The maximum number of repair NCCIs sent between two periodic NCCIs",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&CognitiveControlApplication::m_maxNcciRepairs),
+                          MakeUintegerChecker<uint32_t>())
+            .AddTraceSource("ImplicitAckMiss",
+                            "A neighbor sent a NCCI that doesn't list this node",
+                            MakeTraceSourceAccessor(&CognitiveControlApplication::m_implicitAckMissTrace),
+                            "ns3::CognitiveControlApplication::AddressTracedCallback")
+            .AddTraceSource("ClusterFormed",
+                            "This node became a cluster head or joined one for the first time",
+                            MakeTraceSourceAccessor(&CognitiveControlApplication::m_clusterFormedTrace),
+                            "ns3::CognitiveControlApplication::ClusterFormedTracedCallback")
+            .AddTraceSource("ClusterHeadChange",
+                            "The cluster head of this node changed",
+                            MakeTraceSourceAccessor(&CognitiveControlApplication::m_clusterHeadChangeTrace),
+                            "ns3::CognitiveControlApplication::ClusterHeadChangeTracedCallback");
       return tid;
 }
 
@@ -97,6 +226,36 @@ CognitiveControlApplication::SetSetCommonDataChannelsCallback(SetCommonDataChann
       m_setCommonDataChannelsCallback = c;
 }
 
+void
+
+CognitiveControlApplication::SetSetTdmaScheduleCallback(SetTdmaScheduleCallback c)
+{
+      m_setTdmaScheduleCallback = c;
+}
+
+void
+
+CognitiveControlApplication::SetDenseChannelIndex(bool dense)
+{
+      m_denseChannelIndex = dense;
+      WritableTables().channelIndex.SetDense(dense);
+}
+
+bool
+
+CognitiveControlApplication::GetDenseChannelIndex() const
+{
+      return m_denseChannelIndex;
+}
+
+int64_t
+
+CognitiveControlApplication::AssignStreams(int64_t stream)
+{
+      m_jitter->SetStream(stream);
+      return 1;
+}
+
 
 
 double
@@ -122,6 +281,10 @@ CognitiveControlApplication::StopApplication()
 {
       m_curAction.Cancel();
       m_resense.Cancel();
+      m_scheduleEvent.Cancel();
+      m_ncciRepair.Cancel();
+      m_phaseEvent.Cancel();
+      m_roundEvent.Cancel();
 
 }
 
@@ -130,20 +293,116 @@ void
 CognitiveControlApplication::GetStarted()
 {
       NS_ASSERT_MSG(m_spectrumControlModule,"you haven't linked the spectrum module yet");
+      NS_ABORT_MSG_IF(m_broadcastJitter >= m_phaseTimeout,
+                      "the BroadcastJitter must stay below the PhaseTimeout");
       Simulator::ScheduleNow(&CognitiveControlApplication::StartSensingPeriod,this);
-      m_updateneighbors = Simulator::Schedule(m_updateTables,
-                                              &CognitiveControlApplication::UpdateNeighborsInfoTables,this);
-      m_updateVtable = Simulator::Schedule(m_updateTables,
-                                           &CognitiveControlApplication::CalculateVvalues,this);
+      // every node shifts its timers by its own phase so the neighbors don't act together
+      Time first = m_initialtime + Seconds(m_jitter->GetValue(0,m_startPhaseOffset.GetSeconds()));
+      m_startTime = Simulator::Now();
+      m_ncciNominal = Simulator::Now() + first;
+      Simulator::Schedule(first,&CognitiveControlApplication::SendNCCIMsg,this);
+      Simulator::Schedule(first,&CognitiveControlApplication::StartDiscovery,this);
+}
+
+void
 
-                                           
-      Simulator::Schedule(m_initialtime,&CognitiveControlApplication::SendNCCIMsg,this);
-      Simulator::Schedule(m_initialtime+Seconds(0.2),&CognitiveControlApplication::SendMsg,
-                                                      this,(CognitiveControlMessage::NCCI));
-      Simulator::Schedule(m_initialtime+Seconds(0.3),&CognitiveControlApplication::ChooseMyCluseterCandidate,this);
-      Simulator::Schedule(m_initialtime+Seconds(0.4),&CognitiveControlApplication::EvaluateCH_REQs,this);
-      Simulator::Schedule(m_initialtime+Seconds(0.5),&CognitiveControlApplication::EvaluateCH_ANMs,this);
-      Simulator::Schedule(Seconds(4),&CognitiveControlApplication::EndInitialize,this);
+CognitiveControlApplication::SetClusterState(ClusterState state)
+{
+      NS_LOG_INFO("node " << m_node->GetId() << " cluster state " << m_clusterState << " -> " << state);
+      m_clusterState = state;
+}
+
+void
+
+CognitiveControlApplication::StartDiscovery()
+{
+      SetClusterState(DISCOVERY);
+      m_phaseEvent = Simulator::Schedule(m_discoveryTimeout,&CognitiveControlApplication::EndDiscovery,this);
+}
+
+void
+
+CognitiveControlApplication::CheckDiscovery()
+{
+      if(m_msgs.empty())
+      {
+            return;
+      }
+      for(auto& i : m_msgs)
+      {
+            if(!i.second->GetTables()->neighborsInfo.count(m_address))
+            {
+                  return;
+            }
+      }
+      EndDiscovery();
+}
+
+void
+
+CognitiveControlApplication::EndDiscovery()
+{
+      m_phaseEvent.Cancel();
+      m_roundNominal = Simulator::Now();
+      StartRound();
+}
+
+void
+
+CognitiveControlApplication::StartRound()
+{
+      m_roundEvent = Simulator::Schedule(NextPeriod(m_roundNominal),&CognitiveControlApplication::StartRound,this);
+      SetClusterState(ELECTION);
+      ChooseMyCluseterCandidate();
+      m_phaseEvent.Cancel();
+      m_phaseEvent = Simulator::Schedule(m_phaseTimeout,&CognitiveControlApplication::EndElection,this);
+}
+
+void
+
+CognitiveControlApplication::EndElection()
+{
+      m_phaseEvent.Cancel();
+      EvaluateCH_REQs();
+      if(m_ImClusterHead)
+      {
+            EnterClustered();
+            return;
+      }
+      SetClusterState(JOINING);
+      m_phaseEvent = Simulator::Schedule(m_phaseTimeout,&CognitiveControlApplication::EndJoining,this);
+}
+
+void
+
+CognitiveControlApplication::EndJoining()
+{
+      m_phaseEvent.Cancel();
+      if(EvaluateCH_ANMs())
+      {
+            EnterClustered();
+            return;
+      }
+      SetClusterState(UNCLUSTERED);
+}
+
+void
+
+CognitiveControlApplication::EnterClustered()
+{
+      SetClusterState(CLUSTERED);
+      if(m_clusterFormed)
+      {
+            return;
+      }
+      m_clusterFormed = true;
+      EndInitialize();
+      if(!m_setCommonDataChannelsCallback.IsNull())
+      {
+            m_routingUnite->EnableRouting(true);
+            m_routingUnite->SetCluster(m_CHaddress);
+      }
+      m_clusterFormedTrace(Simulator::Now() - m_startTime,m_CHaddress);
 }
 
 void 
@@ -154,20 +413,64 @@ CognitiveControlApplication::EndInitialize()
 }
 
 
+Time
+
+CognitiveControlApplication::NextPeriod(Time& nominal)
+{
+      nominal += m_clusterAge;
+      return nominal - Simulator::Now() + Seconds(m_jitter->GetValue(0,m_periodJitter.GetSeconds()));
+}
+
 void
 
 CognitiveControlApplication::SendNCCIMsg()
 {
+      m_ncciRepairs = 0;
       Simulator::ScheduleNow(&CognitiveControlApplication::SendMsg,
                               this,(CognitiveControlMessage::NCCI));
-      Simulator::Schedule(m_clusterAge,&CognitiveControlApplication::SendNCCIMsg,this);
+      Simulator::Schedule(NextPeriod(m_ncciNominal),&CognitiveControlApplication::SendNCCIMsg,this);
+}
+
+Time
+
+CognitiveControlApplication::BroadcastCtrlMsg(Ptr<Packet> pkt)
+{
+      Time delay = Seconds(m_jitter->GetValue(0,m_broadcastJitter.GetSeconds()));
+      Simulator::Schedule(delay,&NetDevice::Send,m_controlDevice,pkt,Broadcast,m_protocol);
+      return Simulator::Now() + delay;
+}
+
+void
+
+CognitiveControlApplication::CheckImplicitAck(Ptr<CognitiveControlMessage> msg)
+{
+      // the neighbor had the time to hear the last NCCI of this node
+      if(!m_implicitAck || m_lastNcciTime.IsNegative() ||
+         msg->GetCreationTime() <= m_lastNcciTime + m_implicitAckGuard)
+      {
+            return;
+      }
+      if(msg->GetTables()->neighborsInfo.count(m_address))
+      {
+            return;
+      }
+      m_implicitAckMissTrace(msg->GetSourceAddress());
+      if(!m_ncciRepair.IsPending() && m_ncciRepairs < m_maxNcciRepairs)
+      {
+            m_ncciRepairs++;
+            // the neighbor likely missed our last full refresh and would reject a delta
+            m_forceFullNcci = true;
+            m_ncciRepair = Simulator::ScheduleNow(&CognitiveControlApplication::SendMsg,
+                                                  this,CognitiveControlMessage::NCCI);
+      }
 }
 
 void
 
 CognitiveControlApplication::ReceivingQtable(std::map<uint16_t,double> Qtable)
 {
-      (*m_availableChannelQvalues) = Qtable;
+      WritableTables().channelQuality = Qtable;
+      UpdateMyVvalue();
       m_resense = Simulator::Schedule(m_resenseTime,&CognitiveControlApplication::StartSensingPeriod,this);
 }
 
@@ -192,19 +495,35 @@ CognitiveControlApplication::SendMsg(CognitiveControlMessage::Kind kind)
             GetInfos("Send NCCI");
             Ptr<CognitiveControlMessage> msg = CreateObject<CognitiveControlMessage>();
             m_curEnergy = m_getRemainingEnergyCallback();
-            Ptr<Packet> pkt = Create<Packet>(NCCIsize);
+            UpdateMyVvalue();
+            CognitiveNcciHeader header;
+            bool full = IsFullNcci(m_forceFullNcci,bool(m_ncciBase),m_ncciSinceFull,m_ncciFullRefreshInterval);
+            m_forceFullNcci = false;
+            if(full)
+            {
+                  m_ncciEpoch++;
+                  m_ncciSinceFull = 0;
+                  m_ncciBase = m_tables;
+                  header.SetFull(*m_tables,m_ncciEpoch,m_curEnergy);
+            }
+            else
+            {
+                  m_ncciSinceFull++;
+                  header.SetDelta(*m_ncciBase,*m_tables,m_ncciEpoch,m_curEnergy);
+            }
+            Ptr<Packet> pkt = Create<Packet>();
+            pkt->AddHeader(header);
             msg->SetPacket(pkt);
-            msg->SetChannelQualityMap(m_availableChannelQvalues);
-            msg->SetNeighborNodeConnectivityMap(m_neighborsInfo);
-            msg->SetNeighborClusterReachabilityMap(m_neighborCluster);
+            msg->SetTables(m_tables);
+            msg->SetEpoch(m_ncciEpoch,full);
             msg->SetCreationTime(Simulator::Now());
             msg->SetEnergy(m_curEnergy);
             msg->SetDestinationAddress(Broadcast);
             msg->SetSourceAddress(m_address);
             msg->SetKind(CognitiveControlMessage::NCCI);
             msg->SetNodeId(m_node->GetId());
-            msgMap[pkt->GetUid()] = msg ;
-            m_controlDevice->Send(pkt,Broadcast,m_protocol);
+            RegisterMsg(pkt,msg);
+            m_lastNcciTime = BroadcastCtrlMsg(pkt);
       }
       else if(kind==CognitiveControlMessage::CH_ANM)
       {
@@ -221,8 +540,8 @@ CognitiveControlApplication::SendMsg(CognitiveControlMessage::Kind kind)
             msg->SetCreationTime(Simulator::Now());
             msg->SetPacket(pkt);
             msg->SetKind(CognitiveControlMessage::CH_ANM);
-            msgMap[pkt->GetUid()] = msg;
-            m_controlDevice->Send(pkt,Broadcast,m_protocol);      
+            RegisterMsg(pkt,msg);
+            BroadcastCtrlMsg(pkt);
       }
       else if(kind==CognitiveControlMessage::CH_REQ)
       {
@@ -235,7 +554,7 @@ CognitiveControlApplication::SendMsg(CognitiveControlMessage::Kind kind)
             msg->SetDestinationAddress(m_CHCaddress);
             msg->SetCreationTime(Simulator::Now());
             msg->SetKind(CognitiveControlMessage::CH_REQ);
-            msgMap[pkt->GetUid()] = msg;
+            RegisterMsg(pkt,msg);
             m_controlDevice->Send(pkt,m_CHCaddress,m_protocol);
        
       }
@@ -250,7 +569,7 @@ CognitiveControlApplication::SendMsg(CognitiveControlMessage::Kind kind)
             msg->SetDestinationAddress(m_CHaddress);
             msg->SetCreationTime(Simulator::Now());
             msg->SetKind(CognitiveControlMessage::JOIN_REQ);
-            msgMap[pkt->GetUid()] = msg;
+            RegisterMsg(pkt,msg);
             m_controlDevice->Send(pkt,m_CHaddress,m_protocol); 
       }
       else if(kind==CognitiveControlMessage::GH_ANM)
@@ -268,11 +587,41 @@ CognitiveControlApplication::SendMsg(CognitiveControlMessage::Kind kind)
                   msg->SetDestinationAddress(i.second);
                   msg->SetCreationTime(Simulator::Now());
                   msg->SetKind(CognitiveControlMessage::GH_ANM);
-                  msgMap[pkt->GetUid()] = msg ;
+                  RegisterMsg(pkt,msg);
                   GetInfos("Send GH_ANM");
                   m_controlDevice->Send(pkt,i.second,m_protocol);
             }
       }
+      else if(kind==CognitiveControlMessage::SCHEDULE)
+      {
+            if(!m_ImClusterHead){return;}
+            GetInfos("Send SCHEDULE");
+            // the cluster head owns the first slot, the members follow in address order
+            std::vector<MacKey> members;
+            for(auto& i : m_members_Expiracy)
+            {
+                  members.push_back(i.first);
+            }
+            std::sort(members.begin(),members.end());
+            std::vector<Address> slots{m_address};
+            for(auto& i : members)
+            {
+                  slots.push_back(i.GetAddress());
+            }
+            Ptr<CognitiveControlMessage> msg = CreateObject<CognitiveControlMessage>();
+            Ptr<Packet> pkt = Create<Packet>(SCHEDULEsize + ScheduleSlotSize*slots.size());
+            msg->SetPacket(pkt);
+            msg->SetSourceAddress(m_address);
+            msg->SetDestinationAddress(Broadcast);
+            msg->SetCreationTime(Simulator::Now());
+            msg->SetKind(CognitiveControlMessage::SCHEDULE);
+            msg->SetSchedule(slots,Simulator::Now() + m_tdmaSlot,m_tdmaSlot);
+            RegisterMsg(pkt,msg);
+            ApplySchedule(msg);
+            m_controlDevice->Send(pkt,Broadcast,m_protocol);
+            m_scheduleEvent = Simulator::Schedule(m_schedulePeriod,&CognitiveControlApplication::SendMsg,
+                                                  this,CognitiveControlMessage::SCHEDULE);
+      }
 }
 
 void
@@ -287,10 +636,44 @@ CognitiveControlApplication::ReceiveMsg(Ptr<CognitiveControlMessage> msg)
       {
             GetInfos("Received NCCI");
             Address src = msg->GetSourceAddress();
+            if(msg->IsFullRefresh())
+            {
+                  m_ncciEpochs[src] = msg->GetEpoch();
+            }
+            else
+            {
+                  auto epoch = m_ncciEpochs.find(src);
+                  if(epoch==m_ncciEpochs.end() || epoch->second!=msg->GetEpoch())
+                  {
+                        // the delta is against a full refresh this node missed, the
+                        // neighbor is still alive so its last tables hold until the next one
+                        if(m_ncci_Expiracy.count(src))
+                        {
+                              m_ncci_Expiracy[src].Cancel();
+                              m_ncci_Expiracy[src] = Simulator::Schedule(m_ctrlMsgDuration,
+                                                      &CognitiveControlApplication::DeleteCtrlMsg,this,src,kind);
+                        }
+                        break;
+                  }
+            }
+            bool known = m_msgs.count(src);
             m_msgs[src] = msg;
             m_ncci_Expiracy[src].Cancel();
             m_ncci_Expiracy[src] = Simulator::Schedule(m_ctrlMsgDuration,
                                                       &CognitiveControlApplication::DeleteCtrlMsg,this,src,kind);
+            UpdateNeighborRow(src);
+            CheckImplicitAck(msg);
+            if(m_clusterState==DISCOVERY)
+            {
+                  // tell the new neighbor that this node heard it
+                  if(!known && !m_ncciRepair.IsPending())
+                  {
+                        m_forceFullNcci = true;
+                        m_ncciRepair = Simulator::ScheduleNow(&CognitiveControlApplication::SendMsg,
+                                                              this,CognitiveControlMessage::NCCI);
+                  }
+                  CheckDiscovery();
+            }
             break;
       }
       case(CognitiveControlMessage::CH_REQ):
@@ -301,6 +684,10 @@ CognitiveControlApplication::ReceiveMsg(Ptr<CognitiveControlMessage> msg)
             m_ch_req_Expiracy[reqAddress] = Simulator::Schedule(m_ctrlMsgDuration,
                                                                &CognitiveControlApplication::DeleteCtrlMsg,this,
                                                                 reqAddress,CognitiveControlMessage::CH_REQ);
+            if(m_clusterState==ELECTION && HasChReqQuorum())
+            {
+                  EndElection();
+            }
             break;
       }
       case(CognitiveControlMessage::CH_ANM):
@@ -309,12 +696,18 @@ CognitiveControlApplication::ReceiveMsg(Ptr<CognitiveControlMessage> msg)
             Address CHaddress = msg->GetSourceAddress();
             uint16_t CADC = msg->GetCADC();
             uint16_t CBDC = msg->GetCBDC();
-            (*m_neighborCluster)[CHaddress] = std::make_pair(CADC,CBDC);
+            WritableTables().neighborCluster[CHaddress] = std::make_pair(CADC,CBDC);
+            UpdateMyVvalue();
             m_ch_anm_Expiracy[CHaddress].Cancel();
             m_ch_anm_Expiracy[CHaddress] = 
             Simulator::Schedule(m_ctrlMsgDuration,
                               &CognitiveControlApplication::DeleteCtrlMsg,this,CHaddress,kind);
-       
+            // the cluster heads of the round announce within the broadcast jitter
+            if(m_clusterState==JOINING && Simulator::GetDelayLeft(m_phaseEvent) > m_broadcastJitter)
+            {
+                  m_phaseEvent.Cancel();
+                  m_phaseEvent = Simulator::Schedule(m_broadcastJitter,&CognitiveControlApplication::EndJoining,this);
+            }
             break;
       }
       case(CognitiveControlMessage::JOIN_REQ):
@@ -339,6 +732,16 @@ CognitiveControlApplication::ReceiveMsg(Ptr<CognitiveControlMessage> msg)
             m_clusters.insert(msg->GetSourceAddress());
             break;
       }
+      case(CognitiveControlMessage::SCHEDULE):
+      {
+            if(m_ImClusterHead || msg->GetSourceAddress()!=m_CHaddress)
+            {
+                  break;
+            }
+            GetInfos("Received SCHEDULE");
+            ApplySchedule(msg);
+            break;
+      }
       default:
             NS_ASSERT_MSG(false,"An Unknown type control message");
       }
@@ -347,6 +750,22 @@ CognitiveControlApplication::ReceiveMsg(Ptr<CognitiveControlMessage> msg)
 
 void
 
+CognitiveControlApplication::RegisterMsg(Ptr<Packet> pkt, Ptr<CognitiveControlMessage> msg)
+{
+      msgMap[pkt->GetUid()] = msg;
+      // the receivers have the message long before it expires, then its tables may be freed
+      Simulator::Schedule(m_ctrlMsgDuration,&CognitiveControlApplication::ForgetMsg,pkt->GetUid());
+}
+
+void
+
+CognitiveControlApplication::ForgetMsg(uint32_t uid)
+{
+      msgMap.erase(uid);
+}
+
+void
+
 CognitiveControlApplication::ReceiveControlMsg(Ptr<Packet> pkt)
 {
       if(msgMap.count(pkt->GetUid()))
@@ -371,14 +790,16 @@ CognitiveControlApplication::DeleteCtrlMsg(Address address,
       case(CognitiveControlMessage::NCCI):
       {
             m_msgs.erase(address);
-            (*m_neighborsInfo).erase(address);
+            m_ncciEpochs.erase(address);
             m_ncci_Expiracy.erase(address);
+            RemoveNeighborRow(address);
             break;
       }
       case(CognitiveControlMessage::CH_ANM):
       {
-            (*m_neighborCluster).erase(address);
+            WritableTables().neighborCluster.erase(address);
             m_ch_anm_Expiracy.erase(address);
+            UpdateMyVvalue();
             break;     
       }
       case(CognitiveControlMessage::CH_REQ):
@@ -411,32 +832,87 @@ CognitiveControlApplication::DeleteCtrlMsg(Address address,
 
 }
 
+void
+
+CognitiveControlApplication::ApplySchedule(Ptr<CognitiveControlMessage> msg)
+{
+      if(m_setTdmaScheduleCallback.IsNull())
+      {
+            return;
+      }
+      const std::vector<Address>& slots = msg->GetScheduleSlots();
+      uint32_t mySlot = std::find(slots.begin(),slots.end(),m_address) - slots.begin();
+      m_setTdmaScheduleCallback(msg->GetSuperframeStart(),msg->GetSlotDuration(),mySlot,slots.size());
+}
+
 void 
 
-CognitiveControlApplication::UpdateNeighborsInfoTables()
+CognitiveControlApplication::UpdateNeighborRow(Address address)
 {
-      (*m_neighborsInfo).clear();
-      m_oneHopClust.clear();
-      for(auto& i : (m_msgs))
+      Ptr<CognitiveControlMessage> msg = m_msgs[address];
+      std::set<uint16_t> avCH ;
+      for(auto& j : *(msg->GetChannelQualityMap()))
       {
-            Address tempAd = i.first;
-            ChannelQuality temCQ = i.second->GetChannelQualityMap();
-            std::set<uint16_t> avCH ;
-            for(auto& j : *temCQ)
-            {
-                  avCH.insert(j.first);
-            }
-            (*m_neighborsInfo).insert({tempAd,avCH});
+            avCH.insert(j.first);
+      }
+      NcciTables& tables = WritableTables();
+      auto row = tables.neighborsInfo.find(address);
+      if(row!=tables.neighborsInfo.end())
+      {
+            tables.channelIndex.RemoveChannels(row->second);
+      }
+      tables.channelIndex.AddChannels(avCH);
+      tables.neighborsInfo[address] = avCH;
+      m_oneHopClustDirty = true;
+      m_Vvalues[address] = DoCaculateVvalue(msg);
+      UpdateMyVvalue();
+}
+
+void
+
+CognitiveControlApplication::RemoveNeighborRow(Address address)
+{
+      if(m_tables->neighborsInfo.count(address))
+      {
+            NcciTables& tables = WritableTables();
+            auto row = tables.neighborsInfo.find(address);
+            tables.channelIndex.RemoveChannels(row->second);
+            tables.neighborsInfo.erase(row);
+      }
+      m_Vvalues.erase(address);
+      m_oneHopClustDirty = true;
+      UpdateMyVvalue();
+}
+
+NcciTables&
 
+CognitiveControlApplication::WritableTables()
+{
+      if(m_tables->GetReferenceCount()>1)
+      {
+            m_tables = Create<NcciTables>(*m_tables);
+      }
+      return *m_tables;
+}
+
+void
+
+CognitiveControlApplication::RefreshOneHopClusters()
+{
+      if(!m_oneHopClustDirty)
+      {
+            return;
+      }
+      m_oneHopClust.clear();
+      for(auto& i : m_msgs)
+      {
             NeighborClusterReachability temNCR = i.second->GetNeighborClusterReachabilityMap();
             for(auto& j : *temNCR)
             {
                   m_oneHopClust[j.first] = j.second;
             }
       }
-      
-      m_updateneighbors = Simulator::Schedule(m_updateTables,
-                                              &CognitiveControlApplication::UpdateNeighborsInfoTables,this);
+      m_oneHopClustDirty = false;
 }
 
 
@@ -449,52 +925,24 @@ CognitiveControlApplication::SetAddress(Address address)
 
 void 
 
-CognitiveControlApplication::CalculateVvalues()
+CognitiveControlApplication::UpdateMyVvalue()
 {
-      m_Vvalues.clear();
-      for(auto& i : m_msgs)
-      {
-            m_Vvalues[i.first] = DoCaculateVvalue(i.second);
-      }
       Ptr<CognitiveControlMessage> msg = CreateObject<CognitiveControlMessage>();
-      msg->SetChannelQualityMap(m_availableChannelQvalues);
-      msg->SetNeighborNodeConnectivityMap(m_neighborsInfo);
-      msg->SetNeighborClusterReachabilityMap(m_neighborCluster);
+      msg->SetTables(m_tables);
       msg->SetEnergy(m_curEnergy);
       m_Vvalues[m_address] = DoCaculateVvalue(msg);
-      m_updateVtable = Simulator::Schedule(m_updateTables,
-                                           &CognitiveControlApplication::CalculateVvalues,this);
 }
 
 double
 
 CognitiveControlApplication::DoCaculateVvalue(Ptr<CognitiveControlMessage> msg)
 {
-      std::set<uint16_t> EAC; //!< effective available channels
-      for(auto& i : *(msg->GetChannelQualityMap()))
-      {
-            EAC.insert(i.first);
-      }
-      for(auto& i : *(msg->GetNeighborClusterReachabilityMap()))
-      {
-            EAC.erase(i.second.first);
-      }
-      double CF = 0.0 ;
+      NS_ASSERT_MSG(msg->GetChannelNeighborCount(),"the message doesn't carry the channel index");
       double NN = (double)(*msg->GetNeighborNodeConnectivityMap()).size();
       double NRC = (double)(*msg->GetNeighborClusterReachabilityMap()).size();
       double E = msg->GetEnergy();
-      for(auto& i : EAC)
-      {
-            uint16_t Nkj = 0 ;
-            for(auto& j : *(msg->GetNeighborNodeConnectivityMap()))
-            {
-                  if(j.second.count(i))
-                  {
-                        Nkj++;
-                  }
-            }
-            CF+= (*msg->GetChannelQualityMap())[i]*Nkj;
-      }
+      double CF = msg->GetChannelNeighborCount()->ChannelFitness(*msg->GetChannelQualityMap(),
+                                                                *msg->GetNeighborClusterReachabilityMap());
       double V = m_beta1*(E/m_Emax) + m_beta2*(CF/m_CFmax) + m_beta3*(NRC/m_NRCmax) + m_beta4*(NN/m_NNmax);
       return V; 
 }
@@ -504,53 +952,50 @@ void
 CognitiveControlApplication::ChooseMyCluseterCandidate()
 {
       double mx = 0.0 ;
+      MacKey key;
       Address address;
       for(auto& i : m_Vvalues)
       {
-            if(mx < i.second)
+            // ties go to the smallest address as in the ordered table
+            if(mx < i.second || (!address.IsInvalid() && mx==i.second && i.first < key))
             {
                   mx = i.second;
-                  address = i.first;
+                  key = i.first;
+                  address = i.first.GetAddress();
             }    
       }
+      if(address!=m_CHCaddress && KeepCluster(m_CHCaddress,mx))
+      {
+            address = m_CHCaddress;
+      }
       m_CHCaddress = address;
       if(m_CHCaddress!=m_address)
       {
             Simulator::ScheduleNow(&CognitiveControlApplication::SendMsg,this,
                                    CognitiveControlMessage::CH_REQ);
       }
-      Simulator::Schedule(m_clusterAge,&CognitiveControlApplication::ChooseMyCluseterCandidate,this);
 }
 
 void
 
 CognitiveControlApplication::EvaluateCH_REQs()
 {
-      uint16_t m_nCH_REQ = (uint16_t)(m_ch_req_Expiracy.size());
-      uint16_t m_nNN = (uint16_t)((*m_neighborsInfo).size());
-      if((double)(m_nCH_REQ)>=m_Etta*((double)m_nNN))
+      // a cluster head doesn't resign before the end of its tenure
+      if(HasChReqQuorum() || (m_ImClusterHead && !IsTenureOver()))
       {
             std::set<uint16_t> EAC;
-            for(auto& i : (*m_availableChannelQvalues))
+            for(auto& i : m_tables->channelQuality)
             {
                   EAC.insert(i.first);
             }
-            for(auto& i : (*m_neighborCluster))
+            for(auto& i : m_tables->neighborCluster)
             {
                   EAC.erase(i.second.first);
             }
             std::set<std::pair<double,uint16_t>> channels;
             for(auto& i : EAC)
             {
-                  uint16_t Njk = 0 ;
-                  for(auto& j : (*m_neighborsInfo))
-                  {
-                        if(j.second.count(i))
-                        {
-                              Njk++;
-                        }
-                  }
-                  channels.insert(std::make_pair(Njk*(*m_availableChannelQvalues)[i],i));
+                  channels.insert(std::make_pair(m_tables->channelIndex.GetCount(i)*m_tables->channelQuality.at(i),i));
             }
             if(channels.empty())
             {
@@ -559,14 +1004,21 @@ CognitiveControlApplication::EvaluateCH_REQs()
                   m_CBDC = -1;      
                   return;
             }
-            if(channels.size()>=1){m_CADC = (*channels.rbegin()).second; channels.erase(*channels.rbegin());}
-            if(channels.size()>=1){m_CBDC = (*channels.rbegin()).second; channels.erase(*channels.rbegin());}
-            m_CHaddress = m_address;
+            // a cluster head in its tenure keeps its channels while they stay eligible
+            bool keepChannels = m_ImClusterHead && !IsTenureOver() && EAC.count(m_CADC) &&
+                                (m_CBDC==(uint16_t)(-1) || EAC.count(m_CBDC));
+            if(!keepChannels)
+            {
+                  m_CADC = -1;
+                  m_CBDC = -1;
+                  if(channels.size()>=1){m_CADC = (*channels.rbegin()).second; channels.erase(*channels.rbegin());}
+                  if(channels.size()>=1){m_CBDC = (*channels.rbegin()).second; channels.erase(*channels.rbegin());}
+            }
+            SetClusterHead(m_address);
             m_ImClusterHead = true;
             if(!m_setCommonDataChannelsCallback.IsNull())
             {
-                  double now = (Simulator::Now()).GetSeconds();
-                  if(now>=4)
+                  if(m_clusterFormed)
                   {      
                         m_routingUnite->EnableRouting(true);
                         m_routingUnite->SetCluster(m_CHaddress);
@@ -577,6 +1029,11 @@ CognitiveControlApplication::EvaluateCH_REQs()
                                     CognitiveControlMessage::CH_ANM);
             m_routingUnite->SetClusterHeadStatus(true);
             Simulator::Schedule(Seconds(0.1),&CognitiveControlApplication::ChooseGateways,this);
+            if(m_tdma && !m_scheduleEvent.IsPending())
+            {
+                  m_scheduleEvent = Simulator::Schedule(Seconds(0.1),&CognitiveControlApplication::SendMsg,
+                                                        this,CognitiveControlMessage::SCHEDULE);
+            }
       }
       else
       {
@@ -584,39 +1041,127 @@ CognitiveControlApplication::EvaluateCH_REQs()
             {
                   m_CADC = -1;
                   m_CBDC = -1;
+                  m_scheduleEvent.Cancel();
+                  if(!m_setTdmaScheduleCallback.IsNull())
+                  {
+                        m_setTdmaScheduleCallback(Time(),Time(),0,0);
+                  }
             }
             m_ImClusterHead = false;
             m_routingUnite->SetClusterHeadStatus(false);
       }
-      Simulator::Schedule(m_clusterAge,&CognitiveControlApplication::EvaluateCH_REQs,this);
-      
+}
+
+bool
+
+CognitiveControlApplication::IsTenureOver() const
+{
+      return Simulator::Now() - m_clusterSince >= m_minTenure;
+}
+
+bool
+
+CognitiveControlApplication::KeepCluster(const MacKeyMap<double>& vValues,
+                                         Address current,
+                                         double bestV,
+                                         double margin,
+                                         bool inTenure)
+{
+      // no choice was made yet, the key of an invalid address can't be built
+      if(current.IsInvalid())
+      {
+            return false;
+      }
+      auto v = vValues.find(current);
+      if(v==vValues.end())
+      {
+            return false;
+      }
+      return inTenure || bestV < v->second + margin;
+}
+
+bool
+
+CognitiveControlApplication::IsFullNcci(bool force, bool haveBase, uint32_t sinceFull, uint32_t interval)
+{
+      return force || !haveBase || sinceFull >= interval;
+}
+
+bool
+
+CognitiveControlApplication::KeepCluster(Address current, double bestV) const
+{
+      return KeepCluster(m_Vvalues,current,bestV,m_vMargin,current==m_CHaddress && !IsTenureOver());
 }
 
 void
 
+CognitiveControlApplication::SetClusterHead(Address clusterHead)
+{
+      if(clusterHead==m_CHaddress)
+      {
+            return;
+      }
+      if(!m_CHaddress.IsInvalid())
+      {
+            m_clusterHeadChanges++;
+      }
+      m_clusterHeadChangeTrace(m_CHaddress,clusterHead);
+      m_CHaddress = clusterHead;
+      m_clusterSince = Simulator::Now();
+}
+
+double
+
+CognitiveControlApplication::GetClusterHeadChangesPerMinute() const
+{
+      double minutes = (Simulator::Now() - m_startTime).GetSeconds() / 60;
+      return minutes > 0 ? m_clusterHeadChanges / minutes : 0;
+}
+
+bool
+
+CognitiveControlApplication::HasChReqQuorum() const
+{
+      uint16_t m_nCH_REQ = (uint16_t)(m_ch_req_Expiracy.size());
+      uint16_t m_nNN = (uint16_t)(m_tables->neighborsInfo.size());
+      return (double)(m_nCH_REQ)>=m_Etta*((double)m_nNN);
+}
+
+bool
+
 CognitiveControlApplication::EvaluateCH_ANMs()
 {
       if(m_ImClusterHead)
       {
-            return ;
+            return false;
       } 
       double mx = 0.0;
-      for(auto& i : (*m_neighborCluster))
+      MacKey key;
+      Address best;
+      for(auto& i : m_tables->neighborCluster)
       {
-            if(m_Vvalues[i.first] > mx)
+            // ties go to the smallest address as in the ordered table
+            auto v = m_Vvalues.find(i.first);
+            if(v!=m_Vvalues.end() && (v->second > mx || (mx > 0.0 && v->second==mx && i.first < key)))
             {
-                  mx = m_Vvalues[i.first];
-                  m_CADC = i.second.first;
-                  m_CBDC = i.second.second;
-                  m_CHaddress = i.first;
+                  mx = v->second;
+                  key = i.first;
+                  best = i.first.GetAddress();
             }
       }
+      if(best!=m_CHaddress && m_tables->neighborCluster.count(m_CHaddress) && KeepCluster(m_CHaddress,mx))
+      {
+            best = m_CHaddress;
+      }
       if(mx > 0.0)
       {     
+            m_CADC = m_tables->neighborCluster.at(best).first;
+            m_CBDC = m_tables->neighborCluster.at(best).second;
+            SetClusterHead(best);
             if(!m_setCommonDataChannelsCallback.IsNull())
             {
-                  double now = Simulator::Now().GetSeconds();
-                  if(now>=4)
+                  if(m_clusterFormed)
                   {
                         m_routingUnite->EnableRouting(true);
                   }
@@ -625,13 +1170,11 @@ CognitiveControlApplication::EvaluateCH_ANMs()
             }
             Simulator::ScheduleNow(&CognitiveControlApplication::SendMsg,this,
                                    CognitiveControlMessage::JOIN_REQ);
+            return true;
       }
-      else
-      {
-            m_routingUnite->UnSetCluster();
-            m_routingUnite->EnableRouting(false);
-      }
-      Simulator::Schedule(m_clusterAge,&CognitiveControlApplication::EvaluateCH_ANMs,this);
+      m_routingUnite->UnSetCluster();
+      m_routingUnite->EnableRouting(false);
+      return false;
 }
 
 void
@@ -643,6 +1186,7 @@ CognitiveControlApplication::ChooseGateways()
       {
             return ;
       }
+      RefreshOneHopClusters();
       for(auto& i : m_oneHopClust)
       {
             if(i.first==m_address)
@@ -650,18 +1194,23 @@ CognitiveControlApplication::ChooseGateways()
                   continue;
             }
             double mx = 0.0 ;
+            MacKey temKey;
             Address temAddress;
             for(auto& j : m_msgs)
             {
                   if((*j.second->GetNeighborClusterReachabilityMap()).count(i.first))
                   {
-                        double k = (*j.second->GetChannelQualityMap())[m_CADC] +
-                                   (*j.second->GetChannelQualityMap())[i.second.first];
+                        ChannelQuality CQ = j.second->GetChannelQualityMap();
+                        auto cadc = CQ->find(m_CADC);
+                        auto cadcj = CQ->find(i.second.first);
+                        double k = (cadc==CQ->end() ? 0.0 : cadc->second) +
+                                   (cadcj==CQ->end() ? 0.0 : cadcj->second);
                         k/=2;
-                        if(k > mx)
+                        if(k > mx || (k > 0.0 && k==mx && j.first < temKey))
                         {
                               mx = k ;
-                              temAddress = j.first;
+                              temKey = j.first;
+                              temAddress = j.first.GetAddress();
                         } 
                   }
             }
@@ -734,6 +1283,23 @@ CognitiveControlApplication::IsClusterMember(Address address)
       }
 }
 
+std::vector<Address>
+
+CognitiveControlApplication::GetClusterMembers()
+{
+      std::vector<Address> members;
+      if(!m_ImClusterHead)
+      {
+            return members;
+      }
+      members.reserve(m_members_Expiracy.size());
+      for(auto& i : m_members_Expiracy)
+      {
+            members.push_back(i.first.GetAddress());
+      }
+      return members;
+}
+
 uint16_t
 
 CognitiveControlApplication::GetNumberOfNeighbors()
@@ -10,11 +10,15 @@
 #include "cognitive-general-net-device.h"
 #include "spectrum-control-module.h"
 #include "cognitive-control-message.h"
+#include "cognitive-ncci-header.h"
+#include "cognitive-mac-key.h"
 #include "cognitive-routing-unite.h"
 #include "ns3/application.h"
 #include "ns3/address.h"
 #include "ns3/simulator.h"
 #include "ns3/net-device.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
 
 namespace ns3
 {
@@ -23,6 +27,7 @@ typedef Callback<double , uint16_t> ChannelSensingCallback ;
 typedef Callback<void , Time> StartSensingPeriodCallback ; 
 typedef Callback<double> GetRemainingEnergyCallback ;
 typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
+typedef Callback<void,Time,Time,uint32_t,uint32_t> SetTdmaScheduleCallback;
 
     class CognitiveControlApplication : public Application
     {
@@ -40,6 +45,43 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
           };
 
 
+          /**
+           * the phase of the cluster formation
+           * of this node
+           */
+          enum ClusterState
+          {
+              IDLE,        //!< the first NCCI isn't sent yet
+              DISCOVERY,   //!< exchanging NCCIs until the neighbors list this node
+              ELECTION,    //!< collecting the CH_REQs after choosing a candidate
+              JOINING,     //!< waiting for the CH_ANMs of the cluster heads
+              CLUSTERED,   //!< this node is a cluster head or joined one
+              UNCLUSTERED  //!< the last round ended without a cluster
+          };
+
+          /**
+           * TracedCallback signature for the
+           * first cluster of this node
+           * @param delay the time from the start of the application
+           * @param clusterHead the address of the cluster head
+           */
+          typedef void (*ClusterFormedTracedCallback)(Time delay, Address clusterHead);
+
+          /**
+           * TracedCallback signature for the
+           * cluster head changes of this node
+           * @param oldClusterHead the previous cluster head, invalid before the first cluster
+           * @param newClusterHead the new cluster head
+           */
+          typedef void (*ClusterHeadChangeTracedCallback)(Address oldClusterHead, Address newClusterHead);
+
+          /**
+           * TracedCallback signature for the
+           * neighbors of this node
+           * @param neighbor the address of the neighbor
+           */
+          typedef void (*AddressTracedCallback)(Address neighbor);
+
           CognitiveControlApplication();
           ~CognitiveControlApplication();
 
@@ -90,6 +132,73 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
            */
           void SetSetCommonDataChannelsCallback(SetCommonDataChannelsCallback c);
 
+          /**
+           * @brief set the TDMA schedule
+           * callback of the data device
+           * @param c the callback
+           */
+          void SetSetTdmaScheduleCallback(SetTdmaScheduleCallback c);
+
+          /**
+           * @brief use dense bitsets for the
+           * channel to neighbor count index
+           * @param dense true for dense storage
+           */
+          void SetDenseChannelIndex(bool dense);
+
+          /**
+           * @brief get if the channel index
+           * uses dense storage
+           * @return true for dense storage
+           */
+          bool GetDenseChannelIndex() const;
+
+          /**
+           * @brief assign a fixed random stream to the
+           * random variable of the control timers
+           * @param stream the first stream index
+           * @return the number of streams assigned
+           */
+          int64_t AssignStreams(int64_t stream);
+
+          /**
+           * @brief get the rate of the switches
+           * between two cluster heads
+           * @return the switches per minute since the start
+           */
+          double GetClusterHeadChangesPerMinute() const;
+
+          /**
+           * @brief the hysteresis of the cluster head
+           * choice, the current choice holds during its
+           * tenure and while the best one doesn't exceed
+           * it by the V margin
+           * @param vValues the V values of the neighbors and this node
+           * @param current the current cluster head or candidate, invalid if none
+           * @param bestV the V value of the best one
+           * @param margin the V margin
+           * @param inTenure true if the tenure with the current one isn't over
+           * @return true if the current choice is kept
+           */
+          static bool KeepCluster(const MacKeyMap<double>& vValues,
+                                  Address current,
+                                  double bestV,
+                                  double margin,
+                                  bool inTenure);
+
+          /**
+           * @brief choose between a full and a delta NCCI,
+           * a neighbor that missed a full refresh keeps the
+           * last tables of this node since every delta
+           * extends their expiry there, so the refresh
+           * interval isn't bounded by the control message duration
+           * @param force true if a full refresh is requested
+           * @param haveBase true if a full refresh was already sent
+           * @param sinceFull the number of deltas since the last full refresh
+           * @param interval the number of deltas between two full refreshes
+           * @return true if the next NCCI is a full refresh
+           */
+          static bool IsFullNcci(bool force, bool haveBase, uint32_t sinceFull, uint32_t interval);
 
           /**
            * @brief get the sensing result of a specified channel
@@ -193,6 +302,25 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
            */
           void SetMaximumNeighboringNodes(uint16_t number);
 
+           /**
+            * @brief used by routing
+            * unite to know if the 
+            * address is a cluster 
+            * member
+            * @param address of the node
+            * @return true if the node
+            * is a cluster member
+            */
+           bool IsClusterMember(Address address);
+
+           /**
+            * @brief get the members
+            * of the cluster of this
+            * cluster head
+            * @return the members
+            */
+           std::vector<Address> GetClusterMembers();
+
            /**
             * @brief get number of 
             * neighboring nodes
@@ -212,10 +340,68 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
           void SendNCCIMsg();
 
           /**
-           * @brief updating the neighbor node
-           * connectivity periodically 
+           * @brief make a sent message reachable
+           * by the receivers of its packet until
+           * it expires
+           * @param pkt the packet of the message
+           * @param msg the message
+           */
+          void RegisterMsg(Ptr<Packet> pkt, Ptr<CognitiveControlMessage> msg);
+
+          /**
+           * @brief forget an expired message
+           * @param uid the uid of its packet
+           */
+          static void ForgetMsg(uint32_t uid);
+
+          /**
+           * @brief broadcast a control message
+           * after a random jitter so the neighbors
+           * started together don't collide
+           * @param pkt the packet of the message
+           * @return the time the message is sent
+           */
+          Time BroadcastCtrlMsg(Ptr<Packet> pkt);
+
+          /**
+           * @brief use a NCCI of a neighbor as an
+           * implicit ACK of the last NCCI of this
+           * node, a repair NCCI is sent if the
+           * neighbor doesn't list this node
+           * @param msg the NCCI of the neighbor
+           */
+          void CheckImplicitAck(Ptr<CognitiveControlMessage> msg);
+
+          /**
+           * @brief update the connectivity row
+           * and the V value of one neighbor
+           * after receiving its NCCI
+           * @param address of the neighbor
+           */
+          void UpdateNeighborRow(Address address);
+
+          /**
+           * @brief remove the row and the V
+           * value of a neighbor whose NCCI
+           * expired
+           * @param address of the neighbor
+           */
+          void RemoveNeighborRow(Address address);
+
+          /**
+           * @brief get the NCCI tables for
+           * changing them, they are copied first
+           * if a sent NCCI still shares them
+           * @return the tables
+           */
+          NcciTables& WritableTables();
+
+          /**
+           * @brief rebuild the one hop clusters
+           * table if a NCCI arrived or expired
+           * since the last rebuild
            */
-          void UpdateNeighborsInfoTables();
+          void RefreshOneHopClusters();
 
           /**
            * @brief choose the cluster 
@@ -229,16 +415,99 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
            */
           void EvaluateCH_REQs();
 
+          /**
+           * @brief check if enough neighbors
+           * requested this node as their CH
+           * @return true if this node may be a CH
+           */
+          bool HasChReqQuorum() const;
+
+          /**
+           * @brief check if the node stayed long
+           * enough with its cluster head to switch
+           * @return true if the tenure is over
+           */
+          bool IsTenureOver() const;
+
+          /**
+           * @brief check if the current choice
+           * holds against the best one with the
+           * margin and the tenure of this node
+           * @param current the current cluster head or candidate
+           * @param bestV the V value of the best one
+           * @return true if the current choice is kept
+           */
+          bool KeepCluster(Address current, double bestV) const;
+
+          /**
+           * @brief set the cluster head of this
+           * node and trace the change
+           * @param clusterHead the address of the cluster head
+           */
+          void SetClusterHead(Address clusterHead);
+
           /**
            * @brief evaluate the CH_ANMs
            * to decide the cluster head
+           * @return true if this node joined a cluster
+           */
+          bool EvaluateCH_ANMs();
+
+          /**
+           * @brief move the cluster formation
+           * to a new phase
+           * @param state the new phase
+           */
+          void SetClusterState(ClusterState state);
+
+          /**
+           * @brief start exchanging the NCCIs
+           * of the cluster formation
+           */
+          void StartDiscovery();
+
+          /**
+           * @brief end the discovery if every
+           * known neighbor lists this node
+           */
+          void CheckDiscovery();
+
+          /**
+           * @brief end the discovery and
+           * start the clustering rounds
+           */
+          void EndDiscovery();
+
+          /**
+           * @brief start a clustering round
+           * by choosing the candidate
+           */
+          void StartRound();
+
+          /**
+           * @brief decide being a CH with
+           * the CH_REQs collected
+           */
+          void EndElection();
+
+          /**
+           * @brief join the best announced
+           * cluster head
+           */
+          void EndJoining();
+
+          /**
+           * @brief the node is a cluster head
+           * or joined one, the first time the
+           * routing is enabled
            */
-          void EvaluateCH_ANMs();
+          void EnterClustered();
           /**
-           * @brief calculate the V values
-           * for determining the CH 
+           * @brief recalculate the V value
+           * of this node after its own
+           * tables or energy changed
            */
-           void CalculateVvalues();
+           void UpdateMyVvalue();
 
            /**
             * @brief choose the GateWay 
@@ -252,17 +521,6 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
             * @param address of the node
             */
            double DoCaculateVvalue(Ptr<CognitiveControlMessage> msg);     
-           
-           /**
-            * @brief used by routing
-            * unite to know if the 
-            * address is a cluster 
-            * member
-            * @param address of the node
-            * @return true if the node
-            * is a cluster member
-            */
-           bool IsClusterMember(Address address);
 
            /**
             * @brief get the info of an 
@@ -277,6 +535,23 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
             */
            void EndInitialize();
 
+           /**
+            * @brief advance the nominal time of a
+            * periodic timer by the cluster age
+            * @param nominal the nominal time of the timer
+            * @return the delay until the next period
+            * with a random jitter
+            */
+           Time NextPeriod(Time& nominal);
+
+           /**
+            * @brief pass the slot of this
+            * node in a TDMA schedule to the
+            * data device
+            * @param msg the SCHEDULE message
+            */
+           void ApplySchedule(Ptr<CognitiveControlMessage> msg);
+
           
           Ptr<SpectrumControlModule> m_spectrumControlModule;  //!< the spectrum control module 
           Ptr<NetDevice> m_dataDevice;                         //!< the net device 
@@ -287,33 +562,53 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
           StartSensingPeriodCallback m_startSensingPeriodCallback;
           GetRemainingEnergyCallback m_getRemainingEnergyCallback;
           SetCommonDataChannelsCallback m_setCommonDataChannelsCallback;
+          SetTdmaScheduleCallback m_setTdmaScheduleCallback;
 
 
           EventId m_curAction ;                                //!< the current action to be done
           EventId m_resense;                                   //!< event for resensing and updating Q-table
-          EventId m_updateneighbors;                           //!< update the neighboring nodes table
-          EventId m_updateVtable;                              //!< update the neighboring clusters table
+          EventId m_scheduleEvent;                             //!< the next TDMA schedule of this cluster head
+          EventId m_ncciRepair;                                //!< the pending repair NCCI
+          EventId m_phaseEvent;                                //!< the end of the current formation phase
+          EventId m_roundEvent;                                //!< the next clustering round
 
           Time m_resenseTime;                                  //!< period for resensing
           Time m_ctrlMsgDuration;                              //!< the duration until the expiracy of the control message
           Time m_SendNCCIPeriod;                               //!< the period for sending NCCI msg 
-          Time m_updateTables;                                 //!< the duration for updating tables
           Time m_initialtime;                                  //!< the initial waiting time for sending first NCCI
           Time m_clusterAge;                                   //!< the age of a cluster
+          Time m_tdmaSlot;                                     //!< the duration of a TDMA slot
+          Time m_schedulePeriod;                               //!< the period of the TDMA schedule
+          Time m_broadcastJitter;                              //!< the maximum jitter of the control broadcasts
+          Time m_implicitAckGuard;                             //!< the time a NCCI needs to reach the neighbors
+          Time m_startPhaseOffset;                             //!< the maximum phase offset of the timers
+          Time m_periodJitter;                                 //!< the maximum jitter of each period of the timers
+          Time m_ncciNominal;                                  //!< the nominal time of the periodic NCCI
+          Time m_roundNominal;                                 //!< the nominal time of the clustering round
+          Time m_discoveryTimeout;                             //!< the maximum duration of the discovery
+          Time m_phaseTimeout;                                 //!< the maximum duration of the election and the joining
+          Time m_startTime;                                    //!< the time the application started
+          Time m_minTenure;                                    //!< the minimum time with a cluster head
+          Time m_clusterSince;                                 //!< the time the cluster head last changed
+          Time m_lastNcciTime;                                 //!< the time the last NCCI of this node is sent
+          Ptr<UniformRandomVariable> m_jitter;                 //!< the jitter and phase of the control timers
+          TracedCallback<Address> m_implicitAckMissTrace;      //!< a neighbor didn't list this node
+          TracedCallback<Time,Address> m_clusterFormedTrace;   //!< the first cluster of this node
+          TracedCallback<Address,Address> m_clusterHeadChangeTrace; //!< the cluster head of this node changed
+          ClusterState m_clusterState;                         //!< the phase of the cluster formation
           
-          ChannelQuality m_availableChannelQvalues;            //!< available channels and their Q values
-          NeighborNodeConnectivity m_neighborsInfo;            //!< neighboring nodes and their available channels
-          NeighborClusterReachability m_neighborCluster;       //!< neighboring cluster and their CADC 
-          std::map<Address,std::pair<uint16_t,
-                                     uint16_t>> m_oneHopClust; //!< clusters that I can reach from other nodes
-          std::map<Address,EventId> m_ncci_Expiracy;           //!< the event of the expiract of the NCCI message
-          std::map<Address,EventId> m_ch_anm_Expiracy;         //!< the event of the expiracy of the CH_ANM message 
-          std::map<Address,EventId> m_ch_req_Expiracy;         //!< the event of the expiracy of the CH_REQ message
-          std::map<Address,EventId> m_gh_anm_Expiracy;         //!< the event of the expiracy of the GH_ANM message
-          std::map<Address,EventId> m_members_Expiracy;       //!< the event of the expiracy of the JOIN_REQ message
-          std::map<Address,Ptr<CognitiveControlMessage>> m_msgs;//!< a map containing received messagess
-          std::map<Address,double> m_Vvalues;                  //!< a map containig the Vvalues of the neighboring nodes
-          std::map<Address,Address> m_gateways;                //!< a map containing the gateways of the cluster head 
+          Ptr<NcciTables> m_tables;                            //!< available channels, neighbors, neighboring clusters
+          Ptr<const NcciTables> m_ncciBase;                    //!< the tables sent in the last full refresh
+          MacKeyMap<std::pair<uint16_t,uint16_t>> m_oneHopClust; //!< clusters that I can reach from other nodes
+          MacKeyMap<EventId> m_ncci_Expiracy;                  //!< the event of the expiract of the NCCI message
+          MacKeyMap<EventId> m_ch_anm_Expiracy;                //!< the event of the expiracy of the CH_ANM message 
+          MacKeyMap<EventId> m_ch_req_Expiracy;                //!< the event of the expiracy of the CH_REQ message
+          MacKeyMap<EventId> m_gh_anm_Expiracy;                //!< the event of the expiracy of the GH_ANM message
+          MacKeyMap<EventId> m_members_Expiracy;               //!< the event of the expiracy of the JOIN_REQ message
+          MacKeyMap<Ptr<CognitiveControlMessage>> m_msgs;      //!< a map containing received messagess
+          MacKeyMap<double> m_Vvalues;                         //!< a map containig the Vvalues of the neighboring nodes
+          MacKeyMap<uint32_t> m_ncciEpochs;                    //!< the epoch of the last full NCCI of the neighboring nodes
+          MacKeyMap<Address> m_gateways;                       //!< a map containing the gateways of the cluster head 
 
           std::vector<double> m_channelsQtable;                //!< the Q table of the channels
 
@@ -330,9 +625,17 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
           uint16_t m_CHrequests;                            //!< number of cluster head requests 
           uint16_t m_NNmax;                                 //!< maximum number of neighbors
           uint16_t m_NRCmax;                                //!< maximum number of nighboring clusters
+
+          uint32_t m_ncciEpoch;                             //!< the number of the last full NCCI refresh
+          uint32_t m_ncciSinceFull;                         //!< the number of delta NCCIs since the full refresh
+          uint32_t m_ncciFullRefreshInterval;               //!< the number of delta NCCIs between two full refreshes
+          uint32_t m_ncciRepairs;                           //!< the repair NCCIs sent since the periodic NCCI
+          uint32_t m_maxNcciRepairs;                        //!< the maximum repair NCCIs between two periodic NCCIs
+          uint32_t m_clusterHeadChanges;                    //!< the switches between two cluster heads
           
 
           double m_beta1,m_beta2,m_beta3,m_beta4;           //!< V calculation parameters
+          double m_vMargin;                                 //!< the V margin of switching the cluster head
           double m_CFmax;                                   //!< the channel fitness max value
           double m_Emax;                                    //!< the maximum energy of a node
           double m_Etta;                                    //!< the percentile threshold
@@ -341,8 +644,14 @@ typedef Callback<void,uint16_t,uint16_t,Address> SetCommonDataChannelsCallback;
   
           bool m_ImClusterHead;                             //!< boolean to know if this node is cluster head
           bool m_ImGateway;                                 //!< boolean to know if this node is gateway
-
-          std::set<Address> m_clusters;                     //!< boolean to know the cluster I'm with    
+          bool m_oneHopClustDirty;                          //!< a NCCI arrived or expired since m_oneHopClust was built
+          bool m_denseChannelIndex;                         //!< true if the channel index uses dense storage
+          bool m_tdma;                                      //!< true if the cluster heads schedule the data of their members
+          bool m_implicitAck;                               //!< true if the NCCIs of the neighbors acknowledge this node's NCCI
+          bool m_forceFullNcci;                             //!< true if the next NCCI must be a full refresh
+          bool m_clusterFormed;                             //!< true once this node had a cluster
+
+          MacKeySet m_clusters;                             //!< boolean to know the cluster I'm with    
     };
 }
 
@@ -16,10 +16,10 @@ NS_OBJECT_ENSURE_REGISTERED(CognitiveControlMessage);
 
 CognitiveControlMessage::CognitiveControlMessage()
     : m_pkt(nullptr),
-      m_channelQuality(nullptr),
-      m_neighborNodeConnectivty(nullptr),
-      m_neighborClusterReachability(nullptr),
-      m_energy(0.0)
+      m_tables(nullptr),
+      m_energy(0.0),
+      m_epoch(0),
+      m_fullRefresh(true)
 {
 
 }
@@ -46,9 +46,7 @@ void
 CognitiveControlMessage::DoDispose()
 {
     m_pkt=nullptr;
-    m_channelQuality=nullptr;
-    m_neighborClusterReachability=nullptr;
-    m_neighborNodeConnectivty=nullptr;
+    m_tables=nullptr;
     Object::DoDispose();
 }
 
@@ -96,44 +94,44 @@ CognitiveControlMessage::GetDestinationAddress()
 
 void
 
-CognitiveControlMessage::SetChannelQualityMap(ChannelQuality mp)
+CognitiveControlMessage::SetTables(Ptr<const NcciTables> tables)
 {
-    m_channelQuality = mp;
+    m_tables = tables;
 }
 
-ChannelQuality
+Ptr<const NcciTables>
 
-CognitiveControlMessage::GetChannelQualityMap()
+CognitiveControlMessage::GetTables()
 {
-    return m_channelQuality;
+    return m_tables;
 }
 
-void
+ChannelQuality
 
-CognitiveControlMessage::SetNeighborNodeConnectivityMap(NeighborNodeConnectivity mp)
+CognitiveControlMessage::GetChannelQualityMap()
 {
-    m_neighborNodeConnectivty = mp;
+    return m_tables ? &m_tables->channelQuality : nullptr;
 }
 
 NeighborNodeConnectivity
 
 CognitiveControlMessage::GetNeighborNodeConnectivityMap()
 {
-    return m_neighborNodeConnectivty;
+    return m_tables ? &m_tables->neighborsInfo : nullptr;
 }
 
-void 
+NeighborClusterReachability
 
-CognitiveControlMessage::SetNeighborClusterReachabilityMap(NeighborClusterReachability mp)
+CognitiveControlMessage::GetNeighborClusterReachabilityMap()
 {
-    m_neighborClusterReachability = mp;
+    return m_tables ? &m_tables->neighborCluster : nullptr;
 }
 
-NeighborClusterReachability
+ChannelNeighborCount
 
-CognitiveControlMessage::GetNeighborClusterReachabilityMap()
+CognitiveControlMessage::GetChannelNeighborCount()
 {
-    return m_neighborClusterReachability;
+    return m_tables ? &m_tables->channelIndex : nullptr;
 }
 
 void 
@@ -221,4 +219,56 @@ CognitiveControlMessage::GetNodeId()
 }
 
 
-}
\ No newline at end of file
+void
+
+CognitiveControlMessage::SetEpoch(uint32_t epoch, bool full)
+{
+    m_epoch = epoch;
+    m_fullRefresh = full;
+}
+
+uint32_t
+
+CognitiveControlMessage::GetEpoch()
+{
+    return m_epoch;
+}
+
+bool
+
+CognitiveControlMessage::IsFullRefresh()
+{
+    return m_fullRefresh;
+}
+
+void
+
+CognitiveControlMessage::SetSchedule(const std::vector<Address>& slots, Time start, Time slot)
+{
+    m_slots = slots;
+    m_superframeStart = start;
+    m_slotDuration = slot;
+}
+
+const std::vector<Address>&
+
+CognitiveControlMessage::GetScheduleSlots()
+{
+    return m_slots;
+}
+
+Time
+
+CognitiveControlMessage::GetSuperframeStart()
+{
+    return m_superframeStart;
+}
+
+Time
+
+CognitiveControlMessage::GetSlotDuration()
+{
+    return m_slotDuration;
+}
+
+}
@@ -8,14 +8,19 @@
 #define COGNITIVE_CONTROL_FRAME
 
 #include "cognitive-mac-constants.h"
+#include "cognitive-channel-index.h"
+#include "cognitive-mac-key.h"
 
 #include <ns3/object.h>
+#include <ns3/simple-ref-count.h>
 #include <ns3/packet.h>
 #include <ns3/address.h>
 #include <ns3/nstime.h>
 #include <ns3/data-rate.h>
 #include <iostream>
 #include <map>
+#include <set>
+#include <vector>
 
 namespace ns3
 {
@@ -27,9 +32,24 @@ namespace ns3
  */
 
 
-typedef std::map<uint16_t,double>* ChannelQuality;
-typedef std::map<Address,std::set<uint16_t>>* NeighborNodeConnectivity;
-typedef std::map<Address,std::pair<uint16_t,uint16_t>>* NeighborClusterReachability;
+typedef const std::map<uint16_t,double>* ChannelQuality;
+typedef const MacKeyMap<std::set<uint16_t>>* NeighborNodeConnectivity;
+typedef const MacKeyMap<std::pair<uint16_t,uint16_t>>* NeighborClusterReachability;
+typedef const CognitiveChannelIndex* ChannelNeighborCount;
+
+/**
+ * the tables carried by a NCCI message, a sent
+ * snapshot is shared by the sender and all the
+ * receivers and never changed, the sender copies
+ * it before its next change
+ */
+struct NcciTables : public SimpleRefCount<NcciTables>
+{
+  std::map<uint16_t,double> channelQuality;                        //!< available channels and their Q values
+  MacKeyMap<std::set<uint16_t>> neighborsInfo;                     //!< neighboring nodes and their available channels
+  MacKeyMap<std::pair<uint16_t,uint16_t>> neighborCluster;         //!< neighboring clusters and their CADC,CBDC
+  CognitiveChannelIndex channelIndex;                              //!< number of neighboring nodes on every channel
+};
 
 class CognitiveControlMessage : public Object
 {
@@ -44,7 +64,8 @@ class CognitiveControlMessage : public Object
         CH_ANM,
         CH_REQ,
         JOIN_REQ,
-        GH_ANM
+        GH_ANM,
+        SCHEDULE
       };
 
 
@@ -96,13 +117,19 @@ class CognitiveControlMessage : public Object
       const Address GetDestinationAddress();
 
       /**
-       * @brief Set the channel
-       * quality map
-       * @param mp the map
+       * @brief Set the snapshot
+       * of the NCCI tables
+       * @param tables the snapshot
        */
-      void SetChannelQualityMap(ChannelQuality mp);
+      void SetTables(Ptr<const NcciTables> tables);
+
+      /**
+       * @brief Get the snapshot
+       * of the NCCI tables
+       * @return the snapshot
+       */
+      Ptr<const NcciTables> GetTables();
 
-      
       /**
        * @brief get the channel
        * quality map
@@ -111,35 +138,25 @@ class CognitiveControlMessage : public Object
       ChannelQuality GetChannelQualityMap();
 
       /**
-       * @brief Set the neighboring
-       * channel connectivity map
-       * @param mp the map
-       */
-      void SetNeighborNodeConnectivityMap(NeighborNodeConnectivity mp);
-
-      /**
-       * @brief Set the neighboring
+       * @brief Get the neighboring
        * channel connectivity map
        * @return the map
        */
       NeighborNodeConnectivity GetNeighborNodeConnectivityMap();
 
-
       /**
-       * @brief Set the neighboring 
+       * @brief Get the neighboring 
        * cluster reachability map
-       * @param mp the map
+       * @return the map
        */
-
-       void SetNeighborClusterReachabilityMap(NeighborClusterReachability mp);
+       NeighborClusterReachability GetNeighborClusterReachabilityMap();
 
       /**
-       * @brief Set the neighboring 
-       * cluster reachability map
-       * @return the map
+       * @brief Get the count of the
+       * neighbors on every channel
+       * @return the channel index
        */
-
-       NeighborClusterReachability GetNeighborClusterReachabilityMap();
+       ChannelNeighborCount GetChannelNeighborCount();
 
        /**
         * @brief set the creation
@@ -226,6 +243,59 @@ class CognitiveControlMessage : public Object
        */
       uint32_t GetNodeId();
 
+      /**
+       * @brief Set the number of the
+       * full refresh the NCCI belongs to
+       * @param epoch the epoch
+       * @param full true if the NCCI is
+       * a full refresh
+       */
+      void SetEpoch(uint32_t epoch, bool full);
+
+      /**
+       * @brief Get the number of the
+       * full refresh of the NCCI
+       * @return the epoch
+       */
+      uint32_t GetEpoch();
+
+      /**
+       * @brief is the NCCI
+       * a full refresh
+       * @return true for full refresh
+       */
+      bool IsFullRefresh();
+
+      /**
+       * @brief Set the TDMA superframe
+       * announced by a cluster head
+       * @param slots the owner of every slot, in order
+       * @param start the start of the first superframe
+       * @param slot the duration of a slot
+       */
+      void SetSchedule(const std::vector<Address>& slots, Time start, Time slot);
+
+      /**
+       * @brief Get the owners of the
+       * slots of the superframe
+       * @return the owners in slot order
+       */
+      const std::vector<Address>& GetScheduleSlots();
+
+      /**
+       * @brief Get the start of the
+       * first announced superframe
+       * @return the time
+       */
+      Time GetSuperframeStart();
+
+      /**
+       * @brief Get the duration
+       * of a slot
+       * @return the duration
+       */
+      Time GetSlotDuration();
+
       protected:
       void DoDispose() override;
       
@@ -236,9 +306,7 @@ class CognitiveControlMessage : public Object
       Address m_sourceAddress;  //!< the address of the source of the msg
       Address m_destinAddress;  //!< the address of the destination of the msg
 
-      ChannelQuality m_channelQuality; //!< the map of the channle quality map
-      NeighborNodeConnectivity m_neighborNodeConnectivty; //!< the neighbor connectivity map
-      NeighborClusterReachability m_neighborClusterReachability; //!< the neighbor cluster reachability of the map
+      Ptr<const NcciTables> m_tables;   //!< the snapshot of the NCCI tables
 
       Time m_creationTime;              //!< the creation time of the message
 
@@ -248,6 +316,13 @@ class CognitiveControlMessage : public Object
       uint16_t m_CBDC ;                 //!< the index of the common backup data channel
       
       uint32_t m_nodeId ;               //!< the ID of the creator node
+      uint32_t m_epoch ;                //!< the number of the full refresh of the NCCI
+
+      bool m_fullRefresh ;              //!< true if the NCCI carries all the tables
+
+      std::vector<Address> m_slots;     //!< the owners of the TDMA slots
+      Time m_superframeStart;           //!< the start of the first TDMA superframe
+      Time m_slotDuration;              //!< the duration of a TDMA slot
 
       CognitiveControlMessage::Kind m_kind;            //!< the kind of the message
 
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#include "cognitive-duplicate-cache.h"
+
+#include <ns3/assert.h>
+
+namespace ns3
+{
+
+CognitiveDuplicateCache::CognitiveDuplicateCache()
+    : m_capacity(256),
+      m_next(0)
+{
+    m_index.reserve(m_capacity);
+}
+
+void
+
+CognitiveDuplicateCache::SetCapacity(uint32_t capacity)
+{
+    NS_ASSERT_MSG(capacity > 0,"the duplicate cache must remember at least one request");
+    Clear();
+    m_capacity = capacity;
+    m_ring.reserve(m_capacity);
+    m_index.reserve(m_capacity);
+}
+
+uint32_t
+
+CognitiveDuplicateCache::GetCapacity() const
+{
+    return m_capacity;
+}
+
+bool
+
+CognitiveDuplicateCache::Insert(const Address& originator, uint32_t seq)
+{
+    RequestId id(originator,seq);
+    if(m_index.count(id))
+    {
+        return false;
+    }
+    if(m_ring.size() < m_capacity)
+    {
+        m_ring.push_back(id);
+    }
+    else
+    {
+        m_index.erase(m_ring[m_next]);
+        m_ring[m_next] = id;
+    }
+    m_next = (m_next + 1) % m_capacity;
+    m_index.insert(id);
+    return true;
+}
+
+bool
+
+CognitiveDuplicateCache::Contains(const Address& originator, uint32_t seq) const
+{
+    return m_index.count(RequestId(originator,seq));
+}
+
+uint32_t
+
+CognitiveDuplicateCache::GetSize() const
+{
+    return m_index.size();
+}
+
+void
+
+CognitiveDuplicateCache::Clear()
+{
+    m_ring.clear();
+    m_index.clear();
+    m_next = 0;
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#ifndef COGNITIVE_DUPLICATE_CACHE
+#define COGNITIVE_DUPLICATE_CACHE
+
+#include "cognitive-mac-key.h"
+
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * this class remembers the last route requests
+ * seen by a node as (originator, sequence number)
+ * pairs, a fixed size ring gives the eviction
+ * order and a hashed set the lookup
+ */
+
+class CognitiveDuplicateCache
+{
+    public:
+      CognitiveDuplicateCache();
+
+      /**
+       * @brief set the number of requests
+       * remembered, the cache is cleared
+       * @param capacity the number of requests, at least one
+       */
+      void SetCapacity(uint32_t capacity);
+
+      /**
+       * @brief get the number of requests
+       * remembered
+       * @return the capacity
+       */
+      uint32_t GetCapacity() const;
+
+      /**
+       * @brief remember a request, the oldest
+       * one is forgotten if the cache is full
+       * @param originator the node starting the discovery
+       * @param seq the sequence number of the request
+       * @return true if the request wasn't seen before
+       */
+      bool Insert(const Address& originator, uint32_t seq);
+
+      /**
+       * @brief check if a request was seen
+       * @param originator the node starting the discovery
+       * @param seq the sequence number of the request
+       * @return true if the request is remembered
+       */
+      bool Contains(const Address& originator, uint32_t seq) const;
+
+      /**
+       * @brief get the number of
+       * remembered requests
+       * @return the size
+       */
+      uint32_t GetSize() const;
+
+      /**
+       * @brief forget all the requests
+       */
+      void Clear();
+
+    private:
+      typedef std::pair<MacKey,uint32_t> RequestId;   //!< the originator and the sequence number
+
+      /**
+       * the hash of a request identity
+       */
+      struct RequestIdHash
+      {
+          std::size_t operator()(const RequestId& id) const
+          {
+              return MacKeyHash()(id.first) ^ (id.second * 0x9e3779b97f4a7c15ULL);
+          }
+      };
+
+      std::vector<RequestId> m_ring;                          //!< the requests in arrival order
+      uint32_t m_capacity;                                    //!< the number of requests remembered
+      uint32_t m_next;                                        //!< the slot of the next request
+      std::unordered_set<RequestId,RequestIdHash> m_index;    //!< the remembered requests
+};
+
+}
+
+#endif // COGNITIVE_DUPLICATE_CACHE
@@ -7,6 +7,7 @@
 #include "cognitive-general-net-device.h"
 #include <ns3/boolean.h>
 #include <ns3/channel.h>
+#include <ns3/double.h>
 #include <ns3/enum.h>
 #include <ns3/llc-snap-header.h>
 #include <ns3/log.h>
@@ -76,6 +77,60 @@ CognitiveGeneralNetDevice::GetTypeId()
                 PointerValue(),
                 MakePointerAccessor(&CognitiveGeneralNetDevice::GetPhy, &CognitiveGeneralNetDevice::SetPhy),
                 MakePointerChecker<Object>())
+            .AddAttribute("LinkStatsAlpha",
+                          "The weight of a new acknowledged frame in the averages of the link statistics",
+                          DoubleValue(0.125),
+                          MakeDoubleAccessor(&CognitiveGeneralNetDevice::m_linkStatsAlpha),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("MaxAmpduSubframes",
+                          "The maximum number of frames to the same next hop sent in one "
+                          "aggregated transmission of the data device, 1 disables the aggregation",
+                          UintegerValue(16),
+                          MakeUintegerAccessor(&CognitiveGeneralNetDevice::m_maxAmpduSubframes),
+                          MakeUintegerChecker<uint32_t>(1, 64))
+            .AddAttribute("MaxAmpduSize",
+                          "The maximum size in bytes of an aggregated transmission",
+                          UintegerValue(8192),
+                          MakeUintegerAccessor(&CognitiveGeneralNetDevice::m_maxAmpduSize),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("MaxAmpduDuration",
+                          "The maximum duration of an aggregated transmission",
+                          TimeValue(MilliSeconds(5)),
+                          MakeTimeAccessor(&CognitiveGeneralNetDevice::m_maxAmpduDuration),
+                          MakeTimeChecker())
+            .AddAttribute("MultiChannel",
+                          "Let the data device move the data and the ack of an exchange to the "
+                          "backup data channel of the cluster, the RTS and the CTS stay on the "
+                          "common active data channel",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&CognitiveGeneralNetDevice::m_multiChannel),
+                          MakeBooleanChecker())
+            .AddAttribute("MinCw",
+                          "The minimum contention window of the backoff in slots",
+                          UintegerValue(15),
+                          MakeUintegerAccessor(&CognitiveGeneralNetDevice::m_minCw),
+                          MakeUintegerChecker<uint16_t>(1))
+            .AddAttribute("MaxCw",
+                          "The maximum contention window of the backoff in slots",
+                          UintegerValue(1023),
+                          MakeUintegerAccessor(&CognitiveGeneralNetDevice::m_maxCw),
+                          MakeUintegerChecker<uint16_t>(1))
+            .AddAttribute("ShortRetryLimit",
+                          "The maximum number of retries of an RTS not answered by a CTS",
+                          UintegerValue(7),
+                          MakeUintegerAccessor(&CognitiveGeneralNetDevice::m_shortRetryLimit),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("LongRetryLimit",
+                          "The maximum number of retries of a data frame not answered by an ACK",
+                          UintegerValue(4),
+                          MakeUintegerAccessor(&CognitiveGeneralNetDevice::m_longRetryLimit),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("DropTimeout",
+                          "The time a frame may stay at the head of the queue before it is "
+                          "dropped and its link reported as failed",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&CognitiveGeneralNetDevice::m_dropTime),
+                          MakeTimeChecker())
             .AddTraceSource("MacTx",
                             "Trace source indicating a packet has arrived "
                             "for transmission by this device",
@@ -106,21 +161,39 @@ CognitiveGeneralNetDevice::GetTypeId()
 CognitiveGeneralNetDevice::CognitiveGeneralNetDevice()
     : m_state(IDLE),
       m_IhaveChannel(false),
-      m_CW(4),
+      m_CW(15),
+      m_CADC(0),
+      m_CBDC(0),
       m_threshold(0.0),
       m_currentTX(false),
       m_backoff(false),
       m_dataDevice(false),
-      m_dropTime(Seconds(10))
+      m_clusterEpoch(0),
+      m_dropTime(Seconds(1)),
+      m_attempts(0),
+      m_linkStatsAlpha(0.125),
+      m_maxAmpduSize(8192),
+      m_maxAmpduDuration(MilliSeconds(5)),
+      m_maxAmpduSubframes(16),
+      m_minCw(15),
+      m_maxCw(1023),
+      m_shortRetryLimit(7),
+      m_longRetryLimit(4),
+      m_shortRetries(0),
+      m_longRetries(0),
+      m_multiChannel(false),
+      m_tunedChannel(0),
+      m_tdmaMySlot(0),
+      m_tdmaSlots(0)
 {
     m_rv = CreateObject<UniformRandomVariable>();
+    SetQueue(CreateObject<CognitiveMacQueue>());
     NS_LOG_FUNCTION(this);
 }
 
 CognitiveGeneralNetDevice::~CognitiveGeneralNetDevice()
 {
     NS_LOG_FUNCTION(this);
-    m_queue = nullptr;
 }
 
 void
@@ -131,7 +204,11 @@ CognitiveGeneralNetDevice::DoDispose()
     m_node = nullptr;
     m_channel = nullptr;
     m_data = nullptr;
+    m_nav.Cancel();
+    m_responseTimeout.Cancel();
+    m_queue->Dispose();
     m_queue=nullptr;
+    m_ampdu.clear();
     m_phy = nullptr;
     m_phyTxStartCallback = MakeNullCallback<bool, Ptr<Packet>>();
     m_sensingResult = MakeNullCallback<double,uint16_t>();
@@ -173,9 +250,24 @@ CognitiveGeneralNetDevice::GetMtu() const
 
 void
 
-CognitiveGeneralNetDevice::SetQueue(std::queue<Ptr<MacDcfFrame>> *que)
+CognitiveGeneralNetDevice::SetQueue(Ptr<CognitiveMacQueue> que)
 {
     m_queue = que;
+    m_queue->TraceConnectWithoutContext("Drop",MakeCallback(&CognitiveGeneralNetDevice::NotifyQueueDrop,this));
+}
+
+Ptr<CognitiveMacQueue>
+
+CognitiveGeneralNetDevice::GetQueue() const
+{
+    return m_queue;
+}
+
+void
+
+CognitiveGeneralNetDevice::NotifyQueueDrop(Ptr<const Packet> packet)
+{
+    m_MacTxDropTrace(packet);
 }
 
 void
@@ -285,6 +377,15 @@ CognitiveGeneralNetDevice::GetPhy() const
     return m_phy;
 }
 
+int64_t
+
+CognitiveGeneralNetDevice::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+    m_rv->SetStream(stream);
+    return 1;
+}
+
 void
 
 CognitiveGeneralNetDevice::SetChannel(Ptr<Channel> c)
@@ -360,6 +461,12 @@ void
 
 CognitiveGeneralNetDevice::DIFSPhase()
 { 
+    if(IsNavBusy())
+    {
+        // the medium is reserved, the access resumes when the NAV expires
+        m_sendPhase.Cancel();
+        return;
+    }
     m_senseRes = 0.0 ;
     NS_ASSERT(!m_sensingResult.IsNull());
     double tem = m_sensingResult(1000);
@@ -377,7 +484,7 @@ CognitiveGeneralNetDevice::DIFSDecision()
         if(!m_backoff)
         {
             m_rv->SetAttribute("Min",DoubleValue(0.0));
-            m_rv->SetAttribute("Max",DoubleValue((1<<m_CW)-1));
+            m_rv->SetAttribute("Max",DoubleValue(m_CW));
             m_backOffSlots = m_rv->GetInteger() + 1;
             m_sendPhase.Cancel();
             m_backoff = true ;
@@ -390,6 +497,12 @@ void
 
 CognitiveGeneralNetDevice::BackOffPhase()
 {
+    if(IsNavBusy())
+    {
+        // the remaining slots are counted after the NAV expires
+        m_sendPhase.Cancel();
+        return;
+    }
     if(m_backOffSlots)
     {
         NS_ASSERT(!m_sensingResult.IsNull());
@@ -444,7 +557,8 @@ CognitiveGeneralNetDevice::SendRTS()
 {
     NS_ASSERT_MSG(m_data,"This Net Device doesn't have a data packet");
     Ptr<Packet> rtsPacket = Create<Packet>(RTSsize);
-    Time duration = m_rate.CalculateBytesTxTime(ACKsize + CTSsize) + 3*SIFS + m_data->GetDuration() + margin ;
+    Time duration = m_rate.CalculateBytesTxTime((m_ampdu.empty() ? ACKsize : BlockACKsize) + CTSsize)
+                    + 3*SIFS + GetDataTxTime() + margin ;
     Ptr<MacDcfFrame> rts = CreateObject<MacDcfFrame>();  
     rts->SetPacket(rtsPacket);
     rts->SetCurrentSender(m_data->GetCurrentSender());
@@ -452,7 +566,9 @@ CognitiveGeneralNetDevice::SendRTS()
     rts->SetDuration(duration);
     rts->SetKind(FrameType::RTS);
     rts->SetOriginalPacketUid(m_data->GetPacket()->GetUid());
+    rts->SetDataChannel(ChooseDataChannel());
     m_map[rtsPacket->GetUid()] = rts; 
+    m_attempts++;
     m_sendPhase.Cancel(); 
     m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::StartTransmission,this,rtsPacket);
 }
@@ -462,6 +578,12 @@ void
 CognitiveGeneralNetDevice::ReceiveRTS()
 {
     m_sendPhase.Cancel();
+    if(IsNavBusy() || IsChannelReserved(m_rdata->GetDataChannel()))
+    {
+        // another exchange reserved the medium around us
+        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
+        return;
+    }
     m_sendPhase = Simulator::Schedule(SIFS,&CognitiveGeneralNetDevice::SendCTS,this);
 }
 
@@ -478,6 +600,7 @@ CognitiveGeneralNetDevice::SendCTS()
     cts->SetOriginalPacketUid(m_rdata->GetOriginalPacketUid());
     cts->SetDuration(duration + margin);
     cts->SetKind(FrameType::CTS);
+    cts->SetDataChannel(m_rdata->GetDataChannel());
     m_map[ctsPacket->GetUid()] = cts;
     m_sendPhase.Cancel();
     m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::StartTransmission,this,ctsPacket);
@@ -487,6 +610,8 @@ void
 
 CognitiveGeneralNetDevice::ReceiveCTS()
 {
+    m_responseTimeout.Cancel();
+    TuneDataChannel(m_rdata->GetDataChannel());
     m_sendPhase.Cancel();
     m_sendPhase = Simulator::Schedule(SIFS,&CognitiveGeneralNetDevice::TransmitData,this);
 }
@@ -497,6 +622,23 @@ CognitiveGeneralNetDevice::TransmitData()
 {
 
     NS_ASSERT_MSG(m_data,"This Net Device doesn't have an address");
+    if(!m_ampdu.empty())
+    {
+        // one PHY transmission carrying all the subframes, acknowledged by a block ack
+        Ptr<MacDcfFrame> ampdu = CreateObject<MacDcfFrame>();
+        ampdu->SetPacket(Create<Packet>(GetAmpduSize()));
+        ampdu->SetCurrentSender(m_data->GetCurrentSender());
+        ampdu->SetCurrentReceiver(m_data->GetCurrentReceiver());
+        ampdu->SetProtocolNumber(m_data->GetProtocolNumber());
+        ampdu->SetOriginalPacketUid(m_data->GetPacket()->GetUid());
+        ampdu->SetDuration(m_rate.CalculateBytesTxTime(BlockACKsize) + SIFS + margin);
+        ampdu->SetKind(FrameType::DATA);
+        ampdu->SetAggregate(m_ampdu);
+        m_map[ampdu->GetPacket()->GetUid()] = ampdu;
+        m_sendPhase.Cancel();
+        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::StartTransmission,this,ampdu->GetPacket());
+        return;
+    }
     Time duration = m_rate.CalculateBytesTxTime(ACKsize) + SIFS;
     m_data->SetDuration(duration + margin);
     m_data->SetKind(FrameType::DATA);
@@ -530,35 +672,123 @@ void
 CognitiveGeneralNetDevice::SendAck()
 {
     
-    Ptr<Packet> ackPacket = Create<Packet>(ACKsize);
     Ptr<MacDcfFrame> ack = CreateObject<MacDcfFrame>();
+    std::vector<Ptr<MacDcfFrame>> received;
+    // a frame already passed up is a retransmission after a lost ack, it is acked again only
+    if(m_rdata->IsAggregate())
+    {
+        std::vector<bool> bitmap;
+        for(auto& subframe : m_rdata->GetAggregate())
+        {
+            if(m_rxFrames.Insert(subframe->GetCurrentSender(),subframe->GetPacket()->GetUid()))
+            {
+                received.push_back(subframe);
+            }
+            bitmap.push_back(true);
+        }
+        ack->SetBlockAck(bitmap);
+        ack->SetOriginalPacketUid(m_rdata->GetOriginalPacketUid());
+    }
+    else
+    {
+        if(m_rxFrames.Insert(m_rdata->GetCurrentSender(),m_rdata->GetPacket()->GetUid()))
+        {
+            received.push_back(m_rdata);
+        }
+        ack->SetOriginalPacketUid(m_rdata->GetPacket()->GetUid());
+    }
+    Ptr<Packet> ackPacket = Create<Packet>(m_rdata->IsAggregate() ? BlockACKsize : ACKsize);
     ack->SetPacket(ackPacket);
     ack->SetCurrentReceiver(m_rdata->GetCurrentSender());
     ack->SetCurrentSender(m_rdata->GetCurrentReceiver());
     ack->SetDuration(Seconds(0.0));
     ack->SetKind(FrameType::ACK);
-    ack->SetOriginalPacketUid(m_rdata->GetOriginalPacketUid());
     m_map[ackPacket->GetUid()] = ack; 
     m_sendPhase.Cancel();
     m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::StartTransmission,this,ackPacket);
     NS_ASSERT_MSG(m_routingUnite,"the Network layer unit isn't set");
-    m_routingUnite->ReceiveFrame(m_rdata);
+    for(auto& frame : received)
+    {
+        m_routingUnite->ReceiveFrame(frame);
+    }
 }
 
 void 
 
 CognitiveGeneralNetDevice::ReceiveAck()
 {
+    if(!m_currentTX || !m_data || m_rdata->GetCurrentSender()!=m_data->GetCurrentReceiver() ||
+       m_rdata->GetOriginalPacketUid()!=m_data->GetPacket()->GetUid())
+    {
+        // a late ack of an earlier exchange, the ack timeout of the current one keeps running
+        NS_LOG_LOGIC("ignoring the ack of packet " << m_rdata->GetOriginalPacketUid());
+        if(!m_responseTimeout.IsPending())
+        {
+            m_sendPhase.Cancel();
+            m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
+        }
+        return;
+    }
+    m_responseTimeout.Cancel();
+    m_CW = m_minCw;
+    if(!m_ampdu.empty())
+    {
+        std::vector<Ptr<MacDcfFrame>> acked;
+        std::vector<Ptr<MacDcfFrame>> missing;
+        SplitBlockAck(m_ampdu,m_rdata->GetBlockAck(),acked,missing);
+        for(auto& subframe : acked)
+        {
+            recPackets+=subframe->GetPacket()->GetSize();
+        }
+        UpdateLinkStats();
+        if(!missing.empty())
+        {
+            // only the missing subframes are sent again, in the next exchange
+            m_data = missing.front();
+            m_ampdu = missing.size() > 1 ? missing : std::vector<Ptr<MacDcfFrame>>();
+            m_sendPhase.Cancel();
+            m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
+            return;
+        }
+        m_ampdu.clear();
+        m_currentTX = false;
+        m_dropPacket.Cancel();
+        m_sendPhase.Cancel();
+        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
+        return;
+    }
     m_currentTX = false;
+    m_dropPacket.Cancel();
     if(m_data->GetProtocolNumber()==1)
     {
         recPackets+=m_data->GetPacket()->GetSize();
     }
+    UpdateLinkStats();
     m_sendPhase.Cancel();
     m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
     
 }
 
+void
+
+CognitiveGeneralNetDevice::SplitBlockAck(const std::vector<Ptr<MacDcfFrame>>& subframes,
+                                         const std::vector<bool>& bitmap,
+                                         std::vector<Ptr<MacDcfFrame>>& acked,
+                                         std::vector<Ptr<MacDcfFrame>>& missing)
+{
+    for(uint32_t i = 0 ; i < subframes.size() ; i++)
+    {
+        if(i < bitmap.size() && bitmap[i])
+        {
+            acked.push_back(subframes[i]);
+        }
+        else
+        {
+            missing.push_back(subframes[i]);
+        }
+    }
+}
+
 bool
 
 CognitiveGeneralNetDevice::Send(Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
@@ -588,21 +818,20 @@ void
 CognitiveGeneralNetDevice::SendFrame(Ptr<MacDcfFrame> frame)
 {
     NS_LOG_LOGIC(this << " state=" << m_state);
-    if (m_queue->empty() && !m_sendPhase.IsPending() && !m_currentTX && m_state==IDLE && m_IhaveChannel)
+    frame->SetEnqueueTime(Simulator::Now());
+    frame->SetClusterEpoch(m_clusterEpoch);
+    if (m_queue->IsEmpty() && !m_sendPhase.IsPending() && !m_currentTX && m_state==IDLE && m_IhaveChannel)
     {
         NS_LOG_LOGIC("new packet is head of queue, starting TX immediately");
         m_currentTX = true;
-        m_data = frame;
+        StartService(frame);
         m_sendPhase.Cancel();
-        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::DIFSPhase,this);
+        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ChannelAccess,this);
     }
     else
     {
         NS_LOG_LOGIC("enqueueing new packet");
-        if (!m_queue->emplace(frame))
-        {
-                m_MacTxDropTrace(frame->GetPacket());
-        }
+        m_queue->Enqueue(frame);
     }
 }
 
@@ -640,6 +869,14 @@ CognitiveGeneralNetDevice::SetCurrentDataChannelCallback(CurrentDataChannelCallb
 
 void
 
+CognitiveGeneralNetDevice::SetLinkFailureCallback(LinkFailureCallback c)
+{
+    NS_LOG_FUNCTION(this);
+    m_linkFailureCallback = c;
+}
+
+void
+
 CognitiveGeneralNetDevice::SetRoutingUnite(Ptr<CognitiveRoutingUnite> routingUnite)
 {
     m_routingUnite = routingUnite;
@@ -678,6 +915,7 @@ CognitiveGeneralNetDevice::NotifyPartialTransmissionEnd(Ptr<const Packet> pkt)
         if(m_data->GetCurrentReceiver()==Mac48Address::ConvertFrom(Broadcast))
         {
             m_currentTX = false;
+            m_dropPacket.Cancel();
             m_sendPhase.Cancel();
             m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
         }
@@ -694,6 +932,30 @@ CognitiveGeneralNetDevice::NotifyPartialTransmissionEnd(Ptr<const Packet> pkt)
             m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
         }
     }
+    Ptr<MacDcfFrame> frame = m_map[pkt->GetUid()];
+    if(frame->GetCurrentReceiver()==Mac48Address::ConvertFrom(Broadcast))
+    {
+        return;
+    }
+    if(frame->GetKind()==FrameType::RTS)
+    {
+        m_responseTimeout.Cancel();
+        m_responseTimeout = Simulator::Schedule(m_rate.CalculateBytesTxTime(CTSsize) + CTStimeout,
+                                                &CognitiveGeneralNetDevice::CtsTimeout,this);
+    }
+    else if(frame->GetKind()==FrameType::DATA && m_currentTX)
+    {
+        m_responseTimeout.Cancel();
+        m_responseTimeout = Simulator::Schedule(m_rate.CalculateBytesTxTime(frame->IsAggregate() ? BlockACKsize : ACKsize) + ACKtimeout,
+                                                &CognitiveGeneralNetDevice::AckTimeout,this);
+    }
+    else if(frame->GetKind()==FrameType::CTS)
+    {
+        // resume if the data announced by the RTS never starts
+        TuneDataChannel(frame->GetDataChannel());
+        m_sendPhase.Cancel();
+        m_sendPhase = Simulator::Schedule(frame->GetDuration(),&CognitiveGeneralNetDevice::ContinueTransmission,this);
+    }
 }
 
 void 
@@ -704,25 +966,23 @@ CognitiveGeneralNetDevice::ContinueTransmission()
     ChangeState(IDLE);
     NS_ASSERT(m_queue);
     if(!m_IhaveChannel){return;}
+    // every exchange starts on the common channel
+    TuneDataChannel(m_CADC);
     if(m_currentTX)
     {
         m_sendPhase.Cancel();
-        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::DIFSPhase,this);
+        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ChannelAccess,this);
     }
     else
     {
-        if (!m_queue->empty())
+        Ptr<MacDcfFrame> data = m_queue->Dequeue();
+        if (data)
         {
-            Ptr<MacDcfFrame> data = m_queue->front();
-            m_queue->pop();
-            NS_ASSERT(data);
-            m_data = data;
+            StartService(data);
             m_currentTX = true;
             NS_LOG_LOGIC("scheduling transmission now");
             m_sendPhase.Cancel();
-            m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::DIFSPhase,this);
-            m_dropPacket.Cancel();
-            m_dropPacket = Simulator::Schedule(m_dropTime,&CognitiveGeneralNetDevice::DropPacket,this);
+            m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ChannelAccess,this);
         }
         else
         {
@@ -731,10 +991,155 @@ CognitiveGeneralNetDevice::ContinueTransmission()
     }
 }
 
+Ptr<CognitiveRoutingUnite>
+
+CognitiveGeneralNetDevice::GetRoutingUnite() const
+{
+    return m_routingUnite;
+}
+
+void
+
+CognitiveGeneralNetDevice::StartService(Ptr<MacDcfFrame> frame)
+{
+    ResolveClusterHead(frame);
+    m_data = frame;
+    m_serviceStart = Simulator::Now();
+    m_attempts = 0;
+    m_shortRetries = 0;
+    m_longRetries = 0;
+    m_CW = m_minCw;
+    m_dropPacket.Cancel();
+    m_dropPacket = Simulator::Schedule(m_dropTime,&CognitiveGeneralNetDevice::DropPacket,this);
+    BuildAmpdu();
+}
+
+void
+
+CognitiveGeneralNetDevice::ResolveClusterHead(Ptr<MacDcfFrame> frame)
+{
+    if(frame->GetClusterEpoch()==m_clusterEpoch)
+    {
+        return;
+    }
+    if(m_CHaddress!=m_address)
+    {
+        frame->SetCurrentReceiver(Mac48Address::ConvertFrom(m_CHaddress));
+    }
+    frame->SetClusterEpoch(m_clusterEpoch);
+}
+
+void
+
+CognitiveGeneralNetDevice::BuildAmpdu()
+{
+    m_ampdu.clear();
+    if(!m_dataDevice || m_maxAmpduSubframes<=1 || m_data->GetProtocolNumber()!=1 ||
+       m_data->GetCurrentReceiver()==Mac48Address::ConvertFrom(Broadcast))
+    {
+        return;
+    }
+    uint32_t size = m_data->GetPacket()->GetSize() + MacHeaderSize + AmpduDelimiterSize;
+    std::vector<Ptr<MacDcfFrame>> subframes{m_data};
+    while(m_queue->Peek() && subframes.size() < m_maxAmpduSubframes)
+    {
+        Ptr<MacDcfFrame> next = m_queue->Peek();
+        ResolveClusterHead(next);
+        uint32_t nextSize = size + next->GetPacket()->GetSize() + MacHeaderSize + AmpduDelimiterSize;
+        if(next->GetCurrentReceiver()!=m_data->GetCurrentReceiver() || next->GetProtocolNumber()!=1 ||
+           nextSize > m_maxAmpduSize || m_rate.CalculateBytesTxTime(nextSize) > m_maxAmpduDuration)
+        {
+            break;
+        }
+        m_queue->Dequeue();
+        subframes.push_back(next);
+        size = nextSize;
+    }
+    if(subframes.size() > 1)
+    {
+        m_ampdu = subframes;
+    }
+}
+
+uint32_t
+
+CognitiveGeneralNetDevice::GetAmpduSize() const
+{
+    uint32_t size = 0;
+    for(auto& subframe : m_ampdu)
+    {
+        size += subframe->GetPacket()->GetSize() + MacHeaderSize + AmpduDelimiterSize;
+    }
+    return size;
+}
+
+Time
+
+CognitiveGeneralNetDevice::GetDataTxTime() const
+{
+    if(m_ampdu.empty())
+    {
+        return m_data->GetDuration();
+    }
+    return m_rate.CalculateBytesTxTime(GetAmpduSize());
+}
+
+void
+
+CognitiveGeneralNetDevice::UpdateLinkStats()
+{
+    if(m_data->GetCurrentReceiver()==Mac48Address::ConvertFrom(Broadcast))
+    {
+        return;
+    }
+    double serviceTime = (Simulator::Now() - m_serviceStart).GetSeconds();
+    double queueDelay = (m_serviceStart - m_data->GetEnqueueTime()).GetSeconds();
+    double retries = m_attempts > 0 ? m_attempts - 1 : 0;
+    LinkStats& stats = m_linkStats[m_data->GetCurrentReceiver()];
+    if(stats.samples==0)
+    {
+        stats.serviceTime = serviceTime;
+        stats.queueDelay = queueDelay;
+        stats.retries = retries;
+    }
+    else
+    {
+        stats.serviceTime += m_linkStatsAlpha*(serviceTime - stats.serviceTime);
+        stats.queueDelay += m_linkStatsAlpha*(queueDelay - stats.queueDelay);
+        stats.retries += m_linkStatsAlpha*(retries - stats.retries);
+    }
+    stats.samples++;
+}
+
+LinkStats
+
+CognitiveGeneralNetDevice::GetLinkStats(Address neighbor) const
+{
+    auto stats = m_linkStats.find(neighbor);
+    return stats==m_linkStats.end() ? LinkStats() : stats->second;
+}
+
 void
 
 CognitiveGeneralNetDevice::DropPacket()
 {
+    if(!m_currentTX)
+    {
+        return;
+    }
+    m_responseTimeout.Cancel();
+    m_dropPacket.Cancel();
+    m_CW = m_minCw;
+    std::vector<Ptr<MacDcfFrame>> dropped = m_ampdu.empty() ? std::vector<Ptr<MacDcfFrame>>{m_data} : m_ampdu;
+    m_ampdu.clear();
+    for(auto& frame : dropped)
+    {
+        m_MacTxDropTrace(frame->GetPacket());
+        if(frame->GetCurrentReceiver()!=Mac48Address::ConvertFrom(Broadcast) && !m_linkFailureCallback.IsNull())
+        {
+            m_linkFailureCallback(frame);
+        }
+    }
     m_currentTX = false;
     m_sendPhase.Cancel();
     m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
@@ -742,6 +1147,188 @@ CognitiveGeneralNetDevice::DropPacket()
 
 void
 
+CognitiveGeneralNetDevice::CtsTimeout()
+{
+    NS_LOG_FUNCTION(this);
+    RetryTransmission(m_shortRetries,m_shortRetryLimit);
+}
+
+void
+
+CognitiveGeneralNetDevice::AckTimeout()
+{
+    NS_LOG_FUNCTION(this);
+    RetryTransmission(m_longRetries,m_longRetryLimit);
+}
+
+void
+
+CognitiveGeneralNetDevice::RetryTransmission(uint32_t& retries, uint32_t limit)
+{
+    if(!m_currentTX)
+    {
+        return;
+    }
+    if(!NextRetry(retries,limit,m_CW,m_maxCw))
+    {
+        DropPacket();
+        return;
+    }
+    m_backoff = false;
+    if(m_state==IDLE)
+    {
+        m_sendPhase.Cancel();
+        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
+    }
+}
+
+bool
+
+CognitiveGeneralNetDevice::NextRetry(uint32_t& retries, uint32_t limit, uint16_t& cw, uint16_t maxCw)
+{
+    if(++retries > limit)
+    {
+        return false;
+    }
+    cw = std::min<uint32_t>(2*cw + 1,maxCw);
+    return true;
+}
+
+void
+
+CognitiveGeneralNetDevice::UpdateNav(Time duration)
+{
+    Time navEnd = Simulator::Now() + duration;
+    if(navEnd <= m_navEnd)
+    {
+        return;
+    }
+    m_navEnd = navEnd;
+    m_nav.Cancel();
+    m_nav = Simulator::Schedule(duration,&CognitiveGeneralNetDevice::NavExpired,this);
+}
+
+bool
+
+CognitiveGeneralNetDevice::IsNavBusy() const
+{
+    return Simulator::Now() < m_navEnd;
+}
+
+void
+
+CognitiveGeneralNetDevice::NavExpired()
+{
+    NS_LOG_FUNCTION(this);
+    if(m_state==IDLE && !m_sendPhase.IsPending())
+    {
+        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
+    }
+}
+
+void
+
+CognitiveGeneralNetDevice::ChannelAccess()
+{
+    if(!m_dataDevice || m_tdmaSlots==0 || m_tdmaSlot.IsZero())
+    {
+        DIFSPhase();
+        return;
+    }
+    m_sendPhase.Cancel();
+    if(IsNavBusy())
+    {
+        // the access resumes when the NAV expires
+        return;
+    }
+    Time now = Simulator::Now();
+    if(now < m_tdmaStart)
+    {
+        m_sendPhase = Simulator::Schedule(m_tdmaStart - now,&CognitiveGeneralNetDevice::ChannelAccess,this);
+        return;
+    }
+    int64_t offset = (now - m_tdmaStart).GetNanoSeconds() % (m_tdmaSlot.GetNanoSeconds()*m_tdmaSlots);
+    uint32_t slot = offset / m_tdmaSlot.GetNanoSeconds();
+    Time slotStart = now - NanoSeconds(offset % m_tdmaSlot.GetNanoSeconds());
+    Time slotEnd = slotStart + m_tdmaSlot;
+    bool broadcast = m_data->GetCurrentReceiver()==Mac48Address::ConvertFrom(Broadcast);
+    Time exchange = m_rate.CalculateBytesTxTime(m_ampdu.empty() ? m_data->GetPacket()->GetSize() : GetAmpduSize()) + margin;
+    if(!broadcast)
+    {
+        exchange += SIFS + m_rate.CalculateBytesTxTime(m_ampdu.empty() ? ACKsize : BlockACKsize);
+    }
+    Time next = slotEnd;
+    if(slot==m_tdmaMySlot)
+    {
+        if(now + SIFS + exchange <= slotEnd)
+        {
+            // the slot is ours, no backoff and no RTS/CTS
+            m_sendPhase = Simulator::Schedule(SIFS,&CognitiveGeneralNetDevice::TransmitData,this);
+            return;
+        }
+    }
+    else if(now >= slotStart + DIFS)
+    {
+        // the owner didn't claim its slot within DIFS, the others contend for the rest of it
+        Time contention = DIFS + SLOT*m_CW + m_rate.CalculateBytesTxTime(RTSsize + CTSsize) + 2*SIFS + exchange;
+        if(now + contention <= slotEnd)
+        {
+            DIFSPhase();
+            return;
+        }
+    }
+    else
+    {
+        next = slotStart + DIFS;
+    }
+    m_sendPhase = Simulator::Schedule(next - now,&CognitiveGeneralNetDevice::ChannelAccess,this);
+}
+
+uint16_t
+
+CognitiveGeneralNetDevice::ChooseDataChannel() const
+{
+    if(m_multiChannel && m_dataDevice && m_CBDC!=m_CADC && !IsChannelReserved(m_CBDC))
+    {
+        return m_CBDC;
+    }
+    return m_CADC;
+}
+
+bool
+
+CognitiveGeneralNetDevice::IsChannelReserved(uint16_t channel) const
+{
+    if(channel==m_CADC)
+    {
+        return false;
+    }
+    auto it = m_channelReservation.find(channel);
+    return it!=m_channelReservation.end() && Simulator::Now() < it->second;
+}
+
+void
+
+CognitiveGeneralNetDevice::ReserveChannel(uint16_t channel, Time duration)
+{
+    Time& reservation = m_channelReservation[channel];
+    reservation = std::max(reservation,Simulator::Now() + duration);
+}
+
+void
+
+CognitiveGeneralNetDevice::TuneDataChannel(uint16_t channel)
+{
+    if(m_currentDataChannel.IsNull() || channel==m_tunedChannel)
+    {
+        return;
+    }
+    m_currentDataChannel(channel);
+    m_tunedChannel = channel;
+}
+
+void
+
 CognitiveGeneralNetDevice::NotifyReceptionStart()
 {
     NS_LOG_FUNCTION(this);
@@ -781,14 +1368,24 @@ CognitiveGeneralNetDevice::NotifyReceptionEndOk(Ptr<Packet> packet)
     m_rdata = m_map[packet->GetUid()];
 
     m_paddress = m_rdata->GetCurrentSender();
+    FrameType typ = m_rdata->GetKind();
     if(m_rdata->GetCurrentReceiver()!=m_address && m_rdata->GetCurrentReceiver()!=Mac48Address::ConvertFrom(Broadcast))
     {
+        if(m_multiChannel && (typ==FrameType::RTS || typ==FrameType::CTS) && m_rdata->GetDataChannel()!=m_tunedChannel)
+        {
+            // the data and the ack of the overheard exchange leave this channel
+            ReserveChannel(m_rdata->GetDataChannel(),m_rdata->GetDuration());
+            UpdateNav(typ==FrameType::RTS ? m_rate.CalculateBytesTxTime(CTSsize) + 2*SIFS : Seconds(0));
+        }
+        else
+        {
+            UpdateNav(m_rdata->GetDuration());
+        }
         m_sendPhase.Cancel();
-        m_sendPhase = Simulator::Schedule(m_rdata->GetDuration(),&CognitiveGeneralNetDevice::ContinueTransmission,this);
+        m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
         return ;
     }
 
-    FrameType typ = m_rdata->GetKind();
     m_sendPhase.Cancel();
     if (typ==FrameType::RTS)
     {
@@ -892,26 +1489,31 @@ void
 CognitiveGeneralNetDevice::SetClusterInfo(uint16_t CADC , uint16_t CBDC, Address CHaddress)
 {
     NS_LOG_FUNCTION(this);
+    if(m_IhaveChannel && CADC==m_CADC && CBDC==m_CBDC && CHaddress==m_CHaddress)
+    {
+        // the same cluster, the queue, the NAV and the tuning hold
+        return;
+    }
     m_sendPhase.Cancel();
     m_CADC = CADC ;
     m_CBDC = CBDC ;
     m_IhaveChannel = true;
-    m_CHaddress = CHaddress;
-    if(!(*m_queue).empty() && m_CHaddress!=m_address)
+    if(CHaddress!=m_CHaddress)
     {
-        std::queue<Ptr<MacDcfFrame>> *temQueue = new std::queue<Ptr<MacDcfFrame>>();
-        while(!(*m_queue).empty())
-        {
-            Ptr<MacDcfFrame> tem = (*m_queue).front();
-            (*m_queue).pop();
-            tem->SetCurrentReceiver(Mac48Address::ConvertFrom(m_CHaddress)); 
-            (*temQueue).push(tem);
-        }
-        m_queue = temQueue;
+        // the schedule of the old cluster head doesn't hold
+        m_tdmaSlots = 0;
     }
+    m_CHaddress = CHaddress;
+    // the queued frames follow the new cluster head when they leave the queue
+    m_clusterEpoch++;
+    // a reservation heard on the old channel doesn't hold on the new one
+    m_nav.Cancel();
+    m_navEnd = Simulator::Now();
+    m_channelReservation.clear();
     if(!m_currentDataChannel.IsNull())
     {
         m_currentDataChannel(m_CADC);
+        m_tunedChannel = m_CADC;
         m_sendPhase.Cancel();
         m_sendPhase = Simulator::ScheduleNow(&CognitiveGeneralNetDevice::ContinueTransmission,this);
     }
@@ -919,6 +1521,17 @@ CognitiveGeneralNetDevice::SetClusterInfo(uint16_t CADC , uint16_t CBDC, Address
 
 void
 
+CognitiveGeneralNetDevice::SetTdmaSchedule(Time start, Time slot, uint32_t mySlot, uint32_t nSlots)
+{
+    NS_LOG_FUNCTION(this << start << slot << mySlot << nSlots);
+    m_tdmaStart = start;
+    m_tdmaSlot = slot;
+    m_tdmaMySlot = mySlot;
+    m_tdmaSlots = nSlots;
+}
+
+void
+
 CognitiveGeneralNetDevice::TransmissionPermission(bool b)
 {
     m_IhaveChannel = b ;
@@ -936,10 +1549,10 @@ void
 
 CognitiveGeneralNetDevice::GetInfos(std::string sname)
 {
-    std::cout << "node_id " << m_node->GetId() << ",";
-    std::cout << "Node Position \"" << m_node->GetObject<MobilityModel>()->GetPosition().x << ",";
-    std::cout << m_node->GetObject<MobilityModel>()->GetPosition().y  << "\",";
-    std::cout << "action " << sname << ",";
-    std::cout << "time " << Simulator::Now().GetSeconds()   << "\n";
+    NS_LOG_INFO("node_id " << m_node->GetId() << ","
+                << "Node Position \"" << m_node->GetObject<MobilityModel>()->GetPosition().x << ","
+                << m_node->GetObject<MobilityModel>()->GetPosition().y << "\","
+                << "action " << sname << ","
+                << "time " << Simulator::Now().GetSeconds());
 }
 }
\ No newline at end of file
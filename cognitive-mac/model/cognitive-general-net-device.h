@@ -10,6 +10,8 @@
 #include "cognitive-mac-constants.h"
 #include "mac-frames.h"
 #include "cognitive-routing-unite.h"
+#include "cognitive-duplicate-cache.h"
+#include "cognitive-mac-queue.h"
 
 #include <ns3/drop-tail-queue.h>
 #include <ns3/address.h>
@@ -49,6 +51,7 @@ typedef Callback<double,uint16_t> SensingResultCallback;
 typedef Callback<void> StopWorkCallback;
 typedef Callback<double> GetRemainingEnergyCallback;
 typedef Callback<void,uint16_t> CurrentDataChannelCallback;
+typedef Callback<void,Ptr<MacDcfFrame>> LinkFailureCallback;
 
     class CognitiveGeneralNetDevice : public NetDevice
     {
@@ -68,7 +71,14 @@ typedef Callback<void,uint16_t> CurrentDataChannelCallback;
          *
          * @param queue
          */
-        virtual void SetQueue(std::queue <Ptr<MacDcfFrame>> *que);
+        virtual void SetQueue(Ptr<CognitiveMacQueue> que);
+
+        /**
+         * get the queue used by this device
+         *
+         * @return the queue
+         */
+        Ptr<CognitiveMacQueue> GetQueue() const;
 
         /**
          * notify the MAC that the PHY has finished a previously started transmission
@@ -151,6 +161,14 @@ typedef Callback<void,uint16_t> CurrentDataChannelCallback;
          */
         void SetCurrentDataChannelCallback(CurrentDataChannelCallback c);
 
+        /**
+         * @brief Set the callback notified
+         * when a unicast frame is dropped
+         * without reaching its next hop
+         * @param c the callback
+         */
+        void SetLinkFailureCallback(LinkFailureCallback c);
+
         /**
          * @brief Set the Phy object which is attached to this device.
          * This object is needed so that we can set/get attributes and
@@ -163,6 +181,14 @@ typedef Callback<void,uint16_t> CurrentDataChannelCallback;
          * @return a reference to the PHY object embedded in this NetDevice.
         */
         Ptr<Object> GetPhy() const;
+
+        /**
+         * @brief assign a fixed random stream
+         * to the random variable of the backoff
+         * @param stream the first stream index
+         * @return the number of streams assigned
+         */
+        int64_t AssignStreams(int64_t stream);
          
         /**
          * @brief sensing the spectrum during DIFS
@@ -230,6 +256,20 @@ typedef Callback<void,uint16_t> CurrentDataChannelCallback;
          */
         void ReceiveAck();
 
+        /**
+         * @brief split the subframes of an
+         * aggregated transmission by its block ack,
+         * a subframe beyond the bitmap is missing
+         * @param subframes the subframes in transmission order
+         * @param bitmap the bitmap of the block ack
+         * @param acked the acknowledged subframes
+         * @param missing the subframes to send again, in order
+         */
+        static void SplitBlockAck(const std::vector<Ptr<MacDcfFrame>>& subframes,
+                                  const std::vector<bool>& bitmap,
+                                  std::vector<Ptr<MacDcfFrame>>& acked,
+                                  std::vector<Ptr<MacDcfFrame>>& missing);
+
         /**
          * @brief Stop the transmission
          * and reception for the sensing
@@ -287,6 +327,16 @@ typedef Callback<void,uint16_t> CurrentDataChannelCallback;
          */
         void SetClusterInfo(uint16_t CADC , uint16_t CBDC , Address CHaddress);
 
+        /**
+         * @brief Set the TDMA superframe of
+         * the cluster announced by its head
+         * @param start the start of the first superframe
+         * @param slot the duration of a slot
+         * @param mySlot the slot of this node, nSlots if it has none
+         * @param nSlots the number of slots, 0 returns to contention
+         */
+        void SetTdmaSchedule(Time start, Time slot, uint32_t mySlot, uint32_t nSlots);
+
         /**
          * @brief allow or forbid
          * transmission
@@ -318,12 +368,120 @@ typedef Callback<void,uint16_t> CurrentDataChannelCallback;
          */
         void SetRoutingUnite(Ptr<CognitiveRoutingUnite> routingUnite);
 
+        /**
+         * @brief get the routing
+         * unite of the device
+         * @return the routing unite
+         */
+        Ptr<CognitiveRoutingUnite> GetRoutingUnite() const;
+
+        /**
+         * @brief get the statistics
+         * measured on the link to a
+         * neighbor
+         * @param neighbor the address of the neighbor
+         * @return the statistics, without samples
+         * if no frame was acknowledged by the neighbor
+         */
+        LinkStats GetLinkStats(Address neighbor) const;
+
         /**
          * @brief drop the current 
          * packet
          */
         void DropPacket();
 
+        /**
+         * @brief no CTS answered the RTS
+         */
+        void CtsTimeout();
+
+        /**
+         * @brief no ACK answered the data
+         */
+        void AckTimeout();
+
+        /**
+         * @brief double the contention window
+         * and retry the current frame, or drop
+         * it if the retry limit is reached
+         * @param retries the retries of the failed exchange
+         * @param limit the retry limit of the exchange
+         */
+        void RetryTransmission(uint32_t& retries, uint32_t limit);
+
+        /**
+         * @brief count a failed exchange of
+         * a frame and double its contention window
+         * @param retries the retries of the failed exchange
+         * @param limit the retry limit of the exchange
+         * @param cw the contention window of the frame
+         * @param maxCw the maximum contention window
+         * @return false if the retry limit is reached,
+         * the frame is dropped and the window is kept
+         */
+        static bool NextRetry(uint32_t& retries, uint32_t limit, uint16_t& cw, uint16_t maxCw);
+
+        /**
+         * @brief extend the NAV by the
+         * duration of an overheard frame
+         * @param duration the duration field of the frame
+         */
+        void UpdateNav(Time duration);
+
+        /**
+         * @brief check if the virtual
+         * carrier sense reports a busy medium
+         * @return true while the NAV is set
+         */
+        bool IsNavBusy() const;
+
+        /**
+         * @brief resume the access to the
+         * medium when the NAV expires
+         */
+        void NavExpired();
+
+        /**
+         * @brief choose the channel of the data
+         * and the ack of the current frame, the
+         * backup channel is used if no overheard
+         * exchange reserved it
+         * @return the channel index
+         */
+        uint16_t ChooseDataChannel() const;
+
+        /**
+         * @brief check if an overheard exchange
+         * reserved a data channel
+         * @param channel the channel index
+         * @return true while the channel is reserved
+         */
+        bool IsChannelReserved(uint16_t channel) const;
+
+        /**
+         * @brief note an overheard exchange
+         * moving to another data channel
+         * @param channel the channel index
+         * @param duration the remaining duration of the exchange
+         */
+        void ReserveChannel(uint16_t channel, Time duration);
+
+        /**
+         * @brief tune the PHY to a data channel
+         * @param channel the channel index
+         */
+        void TuneDataChannel(uint16_t channel);
+
+        /**
+         * @brief access the medium for the
+         * current frame, in the own TDMA slot
+         * without contention, in an unclaimed
+         * slot or without a schedule by DIFS
+         * and backoff
+         */
+        void ChannelAccess();
+
         /**
          * @brief get PDR info
          */
@@ -369,7 +527,55 @@ typedef Callback<void,uint16_t> CurrentDataChannelCallback;
          */
         void GetInfos(std::string sname);
 
-        std:: queue <Ptr<MacDcfFrame>> *m_queue; // !<the packets' queue
+        /**
+         * @brief the current frame starts
+         * its service at the head of the queue
+         * @param frame the frame
+         */
+        void StartService(Ptr<MacDcfFrame> frame);
+
+        /**
+         * @brief add the acknowledged current
+         * frame to the statistics of its link
+         */
+        void UpdateLinkStats();
+
+        /**
+         * @brief report a frame dropped
+         * by the queue
+         * @param packet the packet of the frame
+         */
+        void NotifyQueueDrop(Ptr<const Packet> packet);
+
+        /**
+         * @brief send a frame queued before the
+         * last cluster change to the current cluster head
+         * @param frame the frame leaving the queue
+         */
+        void ResolveClusterHead(Ptr<MacDcfFrame> frame);
+
+        /**
+         * @brief bundle the frames to the same
+         * next hop at the head of the queue
+         * behind the current frame
+         */
+        void BuildAmpdu();
+
+        /**
+         * @brief get the size of the current
+         * transmission with its subframes
+         * @return the size in bytes
+         */
+        uint32_t GetAmpduSize() const;
+
+        /**
+         * @brief get the transmission time of
+         * the current data with its subframes
+         * @return the time
+         */
+        Time GetDataTxTime() const;
+
+        Ptr<CognitiveMacQueue> m_queue; // !<the packets' queue
 
         TracedCallback<Ptr<const Packet>> m_MacTxTrace;
         TracedCallback<Ptr<const Packet>> m_MacTxDropTrace;
@@ -387,6 +593,7 @@ typedef Callback<void,uint16_t> CurrentDataChannelCallback;
         StopWorkCallback m_stopWork;                 //!< stop work of the phy     
         GetRemainingEnergyCallback m_remainingEnergy; //!< get the remaining energy callback 
         CurrentDataChannelCallback m_currentDataChannel; //!< set the current data channel
+        LinkFailureCallback m_linkFailureCallback;    //!< a unicast frame failed to reach its next hop
         TracedCallback<> m_linkChangeCallbacks;       //!< the link change Callback;
         uint32_t m_ifIndex;                 // !< the interface Index
         mutable uint32_t m_mtu;             // !< NetDevice MTU
@@ -414,10 +621,35 @@ typedef Callback<void,uint16_t> CurrentDataChannelCallback;
         inline static uint32_t recPackets = 9;
         EventId m_sendPhase ;               //!< time to retry the transmission
         EventId m_nav ;                     //!< virtual carrier sense timers
+        Time m_navEnd;                      //!< the time the NAV expires
         EventId m_dropPacket;               //!< timer for dropping a packet
+        EventId m_responseTimeout;          //!< timer waiting for the CTS or the ACK
         inline static double latency = 0.0; //!< the total latency over all packets
+        uint32_t m_clusterEpoch;            //!< the number of cluster changes
         Address m_CHaddress;                //!< the address of the cluster head     
         Time m_dropTime;                    //!< the time to drop a packet
+        Time m_serviceStart;                //!< the time the current frame reached the head of the queue
+        uint32_t m_attempts;                //!< the number of RTS sent for the current frame
+        double m_linkStatsAlpha;            //!< the weight of a new sample in the link statistics
+        MacKeyMap<LinkStats> m_linkStats;   //!< the statistics of the links to the neighbors
+        std::vector<Ptr<MacDcfFrame>> m_ampdu;  //!< the subframes of the current transmission, empty if not aggregated
+        uint32_t m_maxAmpduSize;            //!< the maximum size of an aggregated transmission in bytes
+        Time m_maxAmpduDuration;            //!< the maximum duration of an aggregated transmission
+        uint32_t m_maxAmpduSubframes;       //!< the maximum number of aggregated subframes
+        CognitiveDuplicateCache m_rxFrames;     //!< the data frames already passed up, by sender and packet uid
+        uint16_t m_minCw;                   //!< the minimum contention window in slots
+        uint16_t m_maxCw;                   //!< the maximum contention window in slots
+        uint32_t m_shortRetryLimit;         //!< the maximum RTS retries of a frame
+        uint32_t m_longRetryLimit;          //!< the maximum data retries of a frame
+        uint32_t m_shortRetries;            //!< the RTS retries of the current frame
+        uint32_t m_longRetries;             //!< the data retries of the current frame
+        bool m_multiChannel;                //!< the data may move to the backup channel after the RTS/CTS
+        uint16_t m_tunedChannel;            //!< the data channel the PHY is tuned to
+        std::map<uint16_t,Time> m_channelReservation; //!< the end of the overheard exchanges on each data channel
+        Time m_tdmaStart;                   //!< the start of the first TDMA superframe
+        Time m_tdmaSlot;                    //!< the duration of a TDMA slot
+        uint32_t m_tdmaMySlot;              //!< the TDMA slot of this node
+        uint32_t m_tdmaSlots;               //!< the number of TDMA slots, 0 without a schedule
         
     };
 
@@ -20,19 +20,26 @@
     const Time margin = MicroSeconds(1) ;       //!< the marging for the data transmission duration   
     const Time infinty = Seconds(10);
     const Time CTStimeout = MicroSeconds(55);   //!< Timeout waiting for cts
+    const Time ACKtimeout = MicroSeconds(55);   //!< Timeout waiting for ack
     const uint32_t MacHeaderSize = 24;          //!< the size of the MAC header
     const uint32_t PhyHeaderSize = 24;          //!< the size of the PHY header
     const uint32_t RTSsize = 44;                //!< the size of the rts packet in bytes
     const uint32_t CTSsize = 38;                //!< the size of the cts packet in bytes
     const uint32_t ACKsize = 38;                //!< the size of the ack packet in bytes
-    const uint32_t NCCIsize = 500 ;             //!< the size of the NCCI message
+    const uint32_t BlockACKsize = 46;           //!< the size of the block ack packet in bytes
+    const uint32_t AmpduDelimiterSize = 4;      //!< the size of the delimiter of an aggregated subframe
     const uint32_t CH_ANMsize = 50 ;            //!< the size of CH_ANM message
     const uint32_t CH_REQsize = 50 ;            //!< the size of the CH_REQ message
     const uint32_t JOIN_REQsize = 50 ;          //!< the size of JOIN_REQ message
     const uint32_t GH_ANMsize = 50 ;            //!< the size of the GH_ANM message 
+    const uint32_t SCHEDULEsize = 20 ;          //!< the size of the fixed part of the SCHEDULE message
+    const uint32_t ScheduleSlotSize = 6 ;       //!< the size of a slot entry of the SCHEDULE message
     const uint32_t RReqSize = 50 ;              //!< the size of the RReq message
     const uint32_t RRepSize = 50 ;              //!< the size of the RRep message
     const uint32_t RErrSize = 50 ;              //!< the size of the RErr message
+    const uint32_t CDVsize = 16 ;               //!< the size of the fixed part of the CDV message
+    const uint32_t CDVEntrySize = 13 ;           //!< the size of a cluster entry of the CDV message
+    const uint32_t CDVMemberSize = 6 ;          //!< the size of a member entry of the CDV message
 
     const Address Broadcast = (Mac48Address::GetBroadcast()).ConvertTo();     //!< broadcast address
     
@@ -52,6 +59,7 @@
          RReq,   //!< Route Request msg
          RRep,   //!< Route Reply msg
          RErr,   //!< error msg to state route error
+         CDV,    //!< cluster distance vector msg
    };
 
    enum FrameType
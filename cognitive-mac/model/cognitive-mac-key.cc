@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#include "cognitive-mac-key.h"
+
+namespace ns3
+{
+
+MacKey::MacKey()
+    : m_value(0)
+{
+
+}
+
+MacKey::MacKey(const Address& address)
+    : MacKey(Mac48Address::ConvertFrom(address))
+{
+
+}
+
+MacKey::MacKey(Mac48Address address)
+    : m_value(0)
+{
+    uint8_t buffer[6];
+    address.CopyTo(buffer);
+    for(uint8_t i = 0 ; i < 6 ; i++)
+    {
+        m_value = (m_value << 8) | buffer[i];
+    }
+}
+
+Address
+
+MacKey::GetAddress() const
+{
+    uint8_t buffer[6];
+    for(uint8_t i = 0 ; i < 6 ; i++)
+    {
+        buffer[5-i] = (uint8_t)(m_value >> (8*i));
+    }
+    Mac48Address address;
+    address.CopyFrom(buffer);
+    return address;
+}
+
+uint64_t
+
+MacKey::GetValue() const
+{
+    return m_value;
+}
+
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#ifndef COGNITIVE_MAC_KEY
+#define COGNITIVE_MAC_KEY
+
+#include <ns3/address.h>
+#include <ns3/mac48-address.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace ns3
+{
+
+/**
+ * this class packs the 48 bits of a MAC address
+ * in an integer, it is the key of the hashed
+ * tables of the control and routing planes,
+ * the keys are ordered as the addresses
+ */
+
+class MacKey
+{
+    public:
+      MacKey();
+
+      /**
+       * @brief build the key of
+       * a MAC address
+       * @param address a Mac48Address
+       */
+      MacKey(const Address& address);
+
+      /**
+       * @brief build the key of
+       * a MAC address
+       * @param address the address
+       */
+      MacKey(Mac48Address address);
+
+      /**
+       * @brief get the address
+       * of the key
+       * @return the Mac48Address
+       */
+      Address GetAddress() const;
+
+      /**
+       * @brief get the packed
+       * 48 bits
+       * @return the value
+       */
+      uint64_t GetValue() const;
+
+      friend bool operator==(const MacKey& a, const MacKey& b) { return a.m_value == b.m_value; }
+      friend bool operator!=(const MacKey& a, const MacKey& b) { return a.m_value != b.m_value; }
+      friend bool operator<(const MacKey& a, const MacKey& b) { return a.m_value < b.m_value; }
+
+    private:
+      uint64_t m_value;    //!< the 48 bits of the address, the first byte is the most significant
+};
+
+/**
+ * the hash of the MacKey, it mixes all the bits
+ * since consecutive allocated addresses differ
+ * only in the last byte
+ */
+struct MacKeyHash
+{
+    std::size_t operator()(const MacKey& key) const
+    {
+        uint64_t x = key.GetValue();
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return (std::size_t)x;
+    }
+};
+
+/**
+ * the hash of a pair of MacKeys
+ */
+struct MacKeyPairHash
+{
+    std::size_t operator()(const std::pair<MacKey,MacKey>& keys) const
+    {
+        return MacKeyHash()(keys.first) ^ (MacKeyHash()(keys.second) * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+template <class T>
+using MacKeyMap = std::unordered_map<MacKey,T,MacKeyHash>;
+
+typedef std::unordered_set<MacKey,MacKeyHash> MacKeySet;
+
+typedef std::unordered_set<std::pair<MacKey,MacKey>,MacKeyPairHash> MacKeyPairSet;
+
+}
+
+#endif // COGNITIVE_MAC_KEY
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#include "cognitive-mac-queue.h"
+
+#include <ns3/enum.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/trace-source-accessor.h>
+#include <ns3/uinteger.h>
+
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("CognitiveMacQueue");
+
+NS_OBJECT_ENSURE_REGISTERED(CognitiveMacQueue);
+
+TypeId
+
+CognitiveMacQueue::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::CognitiveMacQueue")
+            .SetParent<Object>()
+            .SetGroupName("CognitiveMac")
+            .AddConstructor<CognitiveMacQueue>()
+            .AddAttribute("MaxSize",
+                          "The maximum number of frames waiting in both lanes",
+                          UintegerValue(100),
+                          MakeUintegerAccessor(&CognitiveMacQueue::m_maxSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("DropPolicy",
+                          "The frames dropped when the queue is full or the data frames wait too long",
+                          EnumValue(CognitiveMacQueue::DROP_TAIL),
+                          MakeEnumAccessor<DropPolicy>(&CognitiveMacQueue::m_dropPolicy),
+                          MakeEnumChecker(CognitiveMacQueue::DROP_TAIL, "DropTail",
+                                          CognitiveMacQueue::HEAD_DROP, "HeadDrop",
+                                          CognitiveMacQueue::CODEL, "CoDel"))
+            .AddAttribute("CoDelTarget",
+                          "The acceptable sojourn time of the data frames with CoDel",
+                          TimeValue(MilliSeconds(5)),
+                          MakeTimeAccessor(&CognitiveMacQueue::m_target),
+                          MakeTimeChecker())
+            .AddAttribute("CoDelInterval",
+                          "The time the sojourn must stay above the target before CoDel drops",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&CognitiveMacQueue::m_interval),
+                          MakeTimeChecker())
+            .AddTraceSource("Drop",
+                            "A frame was dropped by the queue",
+                            MakeTraceSourceAccessor(&CognitiveMacQueue::m_dropTrace),
+                            "ns3::Packet::TracedCallback")
+            .AddTraceSource("Occupancy",
+                            "The number of control and data frames waiting changed",
+                            MakeTraceSourceAccessor(&CognitiveMacQueue::m_occupancyTrace),
+                            "ns3::CognitiveMacQueue::OccupancyTracedCallback");
+    return tid;
+}
+
+CognitiveMacQueue::CognitiveMacQueue()
+    : m_maxSize(100),
+      m_dropPolicy(DROP_TAIL),
+      m_target(MilliSeconds(5)),
+      m_interval(MilliSeconds(100)),
+      m_dropping(false),
+      m_count(0),
+      m_lastCount(0),
+      m_firstAboveTime(Seconds(0)),
+      m_dropNext(Seconds(0))
+{
+    NS_LOG_FUNCTION(this);
+}
+
+CognitiveMacQueue::~CognitiveMacQueue()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+
+CognitiveMacQueue::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_control.clear();
+    m_data.clear();
+    Object::DoDispose();
+}
+
+bool
+
+CognitiveMacQueue::IsControl(Ptr<MacDcfFrame> frame)
+{
+    return frame->GetProtocolNumber()==1000 || frame->GetProtocolNumber()==989;
+}
+
+bool
+
+CognitiveMacQueue::Enqueue(Ptr<MacDcfFrame> frame)
+{
+    NS_LOG_FUNCTION(this << frame);
+    std::deque<Ptr<MacDcfFrame>>& lane = IsControl(frame) ? m_control : m_data;
+    if(GetNFrames() >= m_maxSize)
+    {
+        if(IsControl(frame) && !m_data.empty())
+        {
+            // the control frames take the place of the oldest data frame
+            Drop(m_data.front());
+            m_data.pop_front();
+        }
+        else if(m_dropPolicy==HEAD_DROP && !lane.empty())
+        {
+            Drop(lane.front());
+            lane.pop_front();
+        }
+        else
+        {
+            Drop(frame);
+            return false;
+        }
+    }
+    lane.push_back(frame);
+    NotifyOccupancy();
+    return true;
+}
+
+Ptr<MacDcfFrame>
+
+CognitiveMacQueue::Peek()
+{
+    if(!m_control.empty())
+    {
+        return m_control.front();
+    }
+    if(m_dropPolicy==CODEL)
+    {
+        CoDelDrop();
+    }
+    if(m_data.empty())
+    {
+        return nullptr;
+    }
+    return m_data.front();
+}
+
+Ptr<MacDcfFrame>
+
+CognitiveMacQueue::Dequeue()
+{
+    Ptr<MacDcfFrame> frame = Peek();
+    if(!frame)
+    {
+        return nullptr;
+    }
+    if(!m_control.empty())
+    {
+        m_control.pop_front();
+    }
+    else
+    {
+        m_data.pop_front();
+    }
+    NotifyOccupancy();
+    return frame;
+}
+
+bool
+
+CognitiveMacQueue::IsEmpty() const
+{
+    return m_control.empty() && m_data.empty();
+}
+
+uint32_t
+
+CognitiveMacQueue::GetNFrames() const
+{
+    return m_control.size() + m_data.size();
+}
+
+void
+
+CognitiveMacQueue::Drop(Ptr<MacDcfFrame> frame)
+{
+    NS_LOG_FUNCTION(this << frame);
+    m_dropTrace(frame->GetPacket());
+}
+
+void
+
+CognitiveMacQueue::CoDelDrop()
+{
+    Time now = Simulator::Now();
+    if(m_data.empty())
+    {
+        m_dropping = false;
+        m_firstAboveTime = Seconds(0);
+        return;
+    }
+    bool okToDrop = CoDelOkToDrop(now);
+    if(m_dropping)
+    {
+        if(!okToDrop)
+        {
+            m_dropping = false;
+            return;
+        }
+        while(m_dropping && now >= m_dropNext)
+        {
+            Drop(m_data.front());
+            m_data.pop_front();
+            m_count++;
+            if(m_data.empty() || !CoDelOkToDrop(now))
+            {
+                m_dropping = false;
+            }
+            else
+            {
+                m_dropNext = CoDelControlLaw(m_dropNext);
+            }
+        }
+        NotifyOccupancy();
+    }
+    else if(okToDrop)
+    {
+        Drop(m_data.front());
+        m_data.pop_front();
+        m_dropping = true;
+        // start near the drop rate of the last dropping state if it ended recently
+        uint32_t delta = m_count - m_lastCount;
+        m_count = (delta > 1 && now - m_dropNext < 16*m_interval) ? delta : 1;
+        m_lastCount = m_count;
+        m_dropNext = CoDelControlLaw(now);
+        NotifyOccupancy();
+    }
+}
+
+bool
+
+CognitiveMacQueue::CoDelOkToDrop(Time now)
+{
+    Time sojourn = now - m_data.front()->GetEnqueueTime();
+    if(sojourn < m_target)
+    {
+        m_firstAboveTime = Seconds(0);
+        return false;
+    }
+    if(m_firstAboveTime.IsZero())
+    {
+        m_firstAboveTime = now + m_interval;
+        return false;
+    }
+    return now >= m_firstAboveTime;
+}
+
+Time
+
+CognitiveMacQueue::CoDelControlLaw(Time t) const
+{
+    return t + Seconds(m_interval.GetSeconds() / std::sqrt(m_count));
+}
+
+void
+
+CognitiveMacQueue::NotifyOccupancy()
+{
+    m_occupancyTrace(m_control.size(),m_data.size());
+}
+
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#ifndef COGNITIVE_MAC_QUEUE
+#define COGNITIVE_MAC_QUEUE
+
+#include "mac-frames.h"
+
+#include <ns3/nstime.h>
+#include <ns3/object.h>
+#include <ns3/packet.h>
+#include <ns3/traced-callback.h>
+
+#include <deque>
+
+namespace ns3
+{
+
+/**
+ * this class is the bounded frame queue of a
+ * net device, the control and routing frames
+ * wait in a priority lane served before the
+ * lane of the data frames, both lanes share
+ * the capacity of the queue
+ */
+
+class CognitiveMacQueue : public Object
+{
+    public:
+      /**
+       * the policy used when the queue is full
+       * or when the frames wait too long
+       */
+      enum DropPolicy
+      {
+          DROP_TAIL,  //!< drop the arriving frame when full
+          HEAD_DROP,  //!< drop the oldest frame of the lane when full
+          CODEL       //!< drop the arriving frame when full and the data frames waiting too long
+      };
+
+      /**
+       * TracedCallback signature for the
+       * occupancy of the queue
+       * @param control the number of control frames
+       * @param data the number of data frames
+       */
+      typedef void (*OccupancyTracedCallback)(uint32_t control, uint32_t data);
+
+      /**
+       * @brief Get the Type ID
+       * @return the object type ID
+       */
+      static TypeId GetTypeId();
+
+      CognitiveMacQueue();
+      ~CognitiveMacQueue() override;
+
+      /**
+       * @brief add a frame to the lane of its
+       * protocol, the drop policy decides which
+       * frame is dropped if the queue is full
+       * @param frame the frame
+       * @return false if the arriving frame was dropped
+       */
+      bool Enqueue(Ptr<MacDcfFrame> frame);
+
+      /**
+       * @brief remove the frame at the
+       * head of the queue
+       * @return the frame, null if the queue is empty
+       */
+      Ptr<MacDcfFrame> Dequeue();
+
+      /**
+       * @brief get the frame at the head of
+       * the queue without removing it, with
+       * CoDel the stale data frames are dropped first
+       * @return the frame, null if the queue is empty
+       */
+      Ptr<MacDcfFrame> Peek();
+
+      /**
+       * @brief check if the queue is empty
+       * @return true if no frame is waiting
+       */
+      bool IsEmpty() const;
+
+      /**
+       * @brief get the number of waiting frames
+       * @return the number of frames in both lanes
+       */
+      uint32_t GetNFrames() const;
+
+      /**
+       * @brief check if a frame waits in
+       * the priority lane
+       * @param frame the frame
+       * @return true for control and routing frames
+       */
+      static bool IsControl(Ptr<MacDcfFrame> frame);
+
+    protected:
+      void DoDispose() override;
+
+    private:
+      /**
+       * @brief drop a frame and
+       * fire the drop trace
+       * @param frame the dropped frame
+       */
+      void Drop(Ptr<MacDcfFrame> frame);
+
+      /**
+       * @brief apply the CoDel dropping state
+       * to the head of the data lane
+       */
+      void CoDelDrop();
+
+      /**
+       * @brief check if the head of the data
+       * lane waited above the target for an interval
+       * @param now the current time
+       * @return true if the head may be dropped
+       */
+      bool CoDelOkToDrop(Time now);
+
+      /**
+       * @brief get the time of the next drop
+       * @param t the time of the current drop
+       * @return the time of the next drop
+       */
+      Time CoDelControlLaw(Time t) const;
+
+      /**
+       * @brief fire the occupancy trace
+       */
+      void NotifyOccupancy();
+
+      std::deque<Ptr<MacDcfFrame>> m_control; //!< the control and routing frames
+      std::deque<Ptr<MacDcfFrame>> m_data;    //!< the data frames
+      uint32_t m_maxSize;                     //!< the capacity in frames
+      DropPolicy m_dropPolicy;                //!< the drop policy
+      Time m_target;                          //!< the acceptable sojourn time of CoDel
+      Time m_interval;                        //!< the sliding window of CoDel
+      bool m_dropping;                        //!< CoDel is in the dropping state
+      uint32_t m_count;                       //!< the drops since CoDel entered the dropping state
+      uint32_t m_lastCount;                   //!< the count of the last dropping state
+      Time m_firstAboveTime;                  //!< when the sojourn time stays above the target
+      Time m_dropNext;                        //!< the time of the next CoDel drop
+      TracedCallback<Ptr<const Packet>> m_dropTrace;            //!< a frame was dropped
+      TracedCallback<uint32_t,uint32_t> m_occupancyTrace;       //!< the occupancy of the lanes changed
+};
+
+}
+
+#endif // COGNITIVE_MAC_QUEUE
@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#include "cognitive-ncci-header.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3
+{
+
+NS_OBJECT_ENSURE_REGISTERED(CognitiveNcciHeader);
+
+static uint32_t
+VarintSize(uint64_t value)
+{
+    uint32_t size = 1;
+    while(value >= 0x80)
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static void
+WriteVarint(Buffer::Iterator& i, uint64_t value)
+{
+    while(value >= 0x80)
+    {
+        i.WriteU8((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    i.WriteU8((uint8_t)value);
+}
+
+static uint64_t
+ReadVarint(Buffer::Iterator& i, bool& ok)
+{
+    uint64_t value = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+    do
+    {
+        if(!ok || i.IsEnd())
+        {
+            ok = false;
+            return 0;
+        }
+        byte = i.ReadU8();
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    }
+    while((byte & 0x80) && shift < 64);
+    return value;
+}
+
+static uint64_t
+ZigZag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t
+UnZigZag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static uint32_t
+AddressSize(const Address& address)
+{
+    return 1 + address.GetSerializedSize();
+}
+
+static void
+WriteAddress(Buffer::Iterator& i, const Address& address)
+{
+    uint8_t buffer[Address::MAX_SIZE + 2];
+    uint32_t len = address.CopyAllTo(buffer, Address::MAX_SIZE + 2);
+    i.WriteU8((uint8_t)len);
+    i.Write(buffer, len);
+}
+
+static Address
+ReadAddress(Buffer::Iterator& i, bool& ok)
+{
+    uint8_t buffer[Address::MAX_SIZE + 2];
+    // the length comes from the wire, a malformed one must not overrun the buffer
+    if(!ok || i.IsEnd())
+    {
+        ok = false;
+        return Address();
+    }
+    uint8_t len = i.ReadU8();
+    if(len < 2 || len > sizeof(buffer) || len > i.GetRemainingSize())
+    {
+        ok = false;
+        return Address();
+    }
+    i.Read(buffer, len);
+    if(buffer[1] + 2 > len)
+    {
+        ok = false;
+        return Address();
+    }
+    Address address;
+    address.CopyAllFrom(buffer, len);
+    return address;
+}
+
+static MacKey
+ReadKey(Buffer::Iterator& i, bool& ok)
+{
+    // the tables are keyed by MAC48 addresses only
+    Address address = ReadAddress(i, ok);
+    if(!ok || !Mac48Address::IsMatchingType(address))
+    {
+        ok = false;
+        return MacKey();
+    }
+    return MacKey(address);
+}
+
+CognitiveNcciHeader::CognitiveNcciHeader()
+    : m_full(true),
+      m_valid(true),
+      m_epoch(0),
+      m_energy(0)
+{
+
+}
+
+CognitiveNcciHeader::~CognitiveNcciHeader()
+{
+
+}
+
+TypeId
+
+CognitiveNcciHeader::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::CognitiveNcciHeader")
+            .SetParent<Header>()
+            .SetGroupName("Network")
+            .AddConstructor<CognitiveNcciHeader>();
+    return tid;
+}
+
+TypeId
+
+CognitiveNcciHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+void
+
+CognitiveNcciHeader::Print(std::ostream& os) const
+{
+    os << (m_full ? "full" : "delta") << " epoch=" << m_epoch
+       << " channels=" << m_quality.size() << "/-" << m_removedChannels.size()
+       << " neighbors=" << m_neighbors.size() << "/-" << m_removedNeighbors.size()
+       << " clusters=" << m_clusters.size() << "/-" << m_removedClusters.size();
+}
+
+uint32_t
+
+CognitiveNcciHeader::GetSerializedSize() const
+{
+    uint32_t size = 1 + VarintSize(m_epoch) + VarintSize(m_energy);
+    size += VarintSize(m_quality.size());
+    for(auto& i : m_quality)
+    {
+        size += VarintSize(i.first) + VarintSize(ZigZag(i.second));
+    }
+    size += VarintSize(m_removedChannels.size());
+    for(auto& i : m_removedChannels)
+    {
+        size += VarintSize(i);
+    }
+    size += VarintSize(m_neighbors.size());
+    for(auto& i : m_neighbors)
+    {
+        size += AddressSize(i.first.GetAddress()) + VarintSize(i.second.size());
+        for(auto& j : i.second)
+        {
+            size += VarintSize(j);
+        }
+    }
+    size += VarintSize(m_removedNeighbors.size());
+    for(auto& i : m_removedNeighbors)
+    {
+        size += AddressSize(i.GetAddress());
+    }
+    size += VarintSize(m_clusters.size());
+    for(auto& i : m_clusters)
+    {
+        size += AddressSize(i.first.GetAddress()) + VarintSize(i.second.first) + VarintSize(i.second.second);
+    }
+    size += VarintSize(m_removedClusters.size());
+    for(auto& i : m_removedClusters)
+    {
+        size += AddressSize(i.GetAddress());
+    }
+    return size;
+}
+
+void
+
+CognitiveNcciHeader::Serialize(Buffer::Iterator start) const
+{
+    Buffer::Iterator i = start;
+    i.WriteU8(m_full ? 1 : 0);
+    WriteVarint(i, m_epoch);
+    WriteVarint(i, m_energy);
+    WriteVarint(i, m_quality.size());
+    for(auto& j : m_quality)
+    {
+        WriteVarint(i, j.first);
+        WriteVarint(i, ZigZag(j.second));
+    }
+    WriteVarint(i, m_removedChannels.size());
+    for(auto& j : m_removedChannels)
+    {
+        WriteVarint(i, j);
+    }
+    WriteVarint(i, m_neighbors.size());
+    for(auto& j : m_neighbors)
+    {
+        WriteAddress(i, j.first.GetAddress());
+        WriteVarint(i, j.second.size());
+        for(auto& k : j.second)
+        {
+            WriteVarint(i, k);
+        }
+    }
+    WriteVarint(i, m_removedNeighbors.size());
+    for(auto& j : m_removedNeighbors)
+    {
+        WriteAddress(i, j.GetAddress());
+    }
+    WriteVarint(i, m_clusters.size());
+    for(auto& j : m_clusters)
+    {
+        WriteAddress(i, j.first.GetAddress());
+        WriteVarint(i, j.second.first);
+        WriteVarint(i, j.second.second);
+    }
+    WriteVarint(i, m_removedClusters.size());
+    for(auto& j : m_removedClusters)
+    {
+        WriteAddress(i, j.GetAddress());
+    }
+}
+
+uint32_t
+
+CognitiveNcciHeader::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    m_quality.clear();
+    m_removedChannels.clear();
+    m_neighbors.clear();
+    m_removedNeighbors.clear();
+    m_clusters.clear();
+    m_removedClusters.clear();
+
+    bool ok = !i.IsEnd();
+    m_full = ok && (i.ReadU8() & 1);
+    m_epoch = (uint32_t)ReadVarint(i, ok);
+    m_energy = ReadVarint(i, ok);
+    uint64_t n = ReadVarint(i, ok);
+    for(uint64_t j = 0 ; ok && j < n ; j++)
+    {
+        uint16_t channel = (uint16_t)ReadVarint(i, ok);
+        m_quality[channel] = UnZigZag(ReadVarint(i, ok));
+    }
+    n = ReadVarint(i, ok);
+    for(uint64_t j = 0 ; ok && j < n ; j++)
+    {
+        m_removedChannels.insert((uint16_t)ReadVarint(i, ok));
+    }
+    n = ReadVarint(i, ok);
+    for(uint64_t j = 0 ; ok && j < n ; j++)
+    {
+        MacKey address = ReadKey(i, ok);
+        uint64_t m = ReadVarint(i, ok);
+        std::set<uint16_t> channels;
+        for(uint64_t k = 0 ; ok && k < m ; k++)
+        {
+            channels.insert((uint16_t)ReadVarint(i, ok));
+        }
+        if(ok)
+        {
+            m_neighbors[address] = channels;
+        }
+    }
+    n = ReadVarint(i, ok);
+    for(uint64_t j = 0 ; ok && j < n ; j++)
+    {
+        MacKey address = ReadKey(i, ok);
+        if(ok)
+        {
+            m_removedNeighbors.insert(address);
+        }
+    }
+    n = ReadVarint(i, ok);
+    for(uint64_t j = 0 ; ok && j < n ; j++)
+    {
+        MacKey address = ReadKey(i, ok);
+        uint16_t CADC = (uint16_t)ReadVarint(i, ok);
+        uint16_t CBDC = (uint16_t)ReadVarint(i, ok);
+        if(ok)
+        {
+            m_clusters[address] = std::make_pair(CADC,CBDC);
+        }
+    }
+    n = ReadVarint(i, ok);
+    for(uint64_t j = 0 ; ok && j < n ; j++)
+    {
+        MacKey address = ReadKey(i, ok);
+        if(ok)
+        {
+            m_removedClusters.insert(address);
+        }
+    }
+    m_valid = ok;
+    if(!m_valid)
+    {
+        // a malformed header carries nothing, Apply leaves the tables as they are
+        m_quality.clear();
+        m_removedChannels.clear();
+        m_neighbors.clear();
+        m_removedNeighbors.clear();
+        m_clusters.clear();
+        m_removedClusters.clear();
+    }
+    return i.GetDistanceFrom(start);
+}
+
+int64_t
+
+CognitiveNcciHeader::Quantize(double q)
+{
+    return (int64_t)std::llround(q * QScale);
+}
+
+void
+
+CognitiveNcciHeader::SetFull(const NcciTables& tables, uint32_t epoch, double energy)
+{
+    NcciTables empty;
+    SetDelta(empty, tables, epoch, energy);
+    m_full = true;
+}
+
+void
+
+CognitiveNcciHeader::SetDelta(const NcciTables& base, const NcciTables& tables,
+                              uint32_t epoch, double energy)
+{
+    m_full = false;
+    m_valid = true;
+    m_epoch = epoch;
+    m_energy = (uint64_t)std::llround(std::max(energy, 0.0) * 1000);
+    m_quality.clear();
+    m_removedChannels.clear();
+    m_neighbors.clear();
+    m_removedNeighbors.clear();
+    m_clusters.clear();
+    m_removedClusters.clear();
+
+    for(auto& i : tables.channelQuality)
+    {
+        auto j = base.channelQuality.find(i.first);
+        if(j==base.channelQuality.end() || Quantize(j->second)!=Quantize(i.second))
+        {
+            m_quality[i.first] = Quantize(i.second);
+        }
+    }
+    for(auto& i : base.channelQuality)
+    {
+        if(!tables.channelQuality.count(i.first))
+        {
+            m_removedChannels.insert(i.first);
+        }
+    }
+    for(auto& i : tables.neighborsInfo)
+    {
+        auto j = base.neighborsInfo.find(i.first);
+        if(j==base.neighborsInfo.end() || j->second!=i.second)
+        {
+            m_neighbors[i.first] = i.second;
+        }
+    }
+    for(auto& i : base.neighborsInfo)
+    {
+        if(!tables.neighborsInfo.count(i.first))
+        {
+            m_removedNeighbors.insert(i.first);
+        }
+    }
+    for(auto& i : tables.neighborCluster)
+    {
+        auto j = base.neighborCluster.find(i.first);
+        if(j==base.neighborCluster.end() || j->second!=i.second)
+        {
+            m_clusters[i.first] = i.second;
+        }
+    }
+    for(auto& i : base.neighborCluster)
+    {
+        if(!tables.neighborCluster.count(i.first))
+        {
+            m_removedClusters.insert(i.first);
+        }
+    }
+}
+
+void
+
+CognitiveNcciHeader::Apply(NcciTables& tables) const
+{
+    if(!m_valid)
+    {
+        return;
+    }
+    if(m_full)
+    {
+        tables.channelQuality.clear();
+        tables.neighborsInfo.clear();
+        tables.neighborCluster.clear();
+        tables.channelIndex.Clear();
+    }
+    for(auto& i : m_removedChannels)
+    {
+        tables.channelQuality.erase(i);
+    }
+    for(auto& i : m_quality)
+    {
+        tables.channelQuality[i.first] = (double)i.second / QScale;
+    }
+    for(auto& i : m_removedNeighbors)
+    {
+        auto j = tables.neighborsInfo.find(i);
+        if(j!=tables.neighborsInfo.end())
+        {
+            tables.channelIndex.RemoveChannels(j->second);
+            tables.neighborsInfo.erase(j);
+        }
+    }
+    for(auto& i : m_neighbors)
+    {
+        auto j = tables.neighborsInfo.find(i.first);
+        if(j!=tables.neighborsInfo.end())
+        {
+            tables.channelIndex.RemoveChannels(j->second);
+        }
+        tables.channelIndex.AddChannels(i.second);
+        tables.neighborsInfo[i.first] = i.second;
+    }
+    for(auto& i : m_removedClusters)
+    {
+        tables.neighborCluster.erase(i);
+    }
+    for(auto& i : m_clusters)
+    {
+        tables.neighborCluster[i.first] = i.second;
+    }
+}
+
+bool
+
+CognitiveNcciHeader::IsFull() const
+{
+    return m_full;
+}
+
+bool
+
+CognitiveNcciHeader::IsValid() const
+{
+    return m_valid;
+}
+
+uint32_t
+
+CognitiveNcciHeader::GetEpoch() const
+{
+    return m_epoch;
+}
+
+double
+
+CognitiveNcciHeader::GetEnergy() const
+{
+    return (double)m_energy / 1000;
+}
+
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2025 Telecommunications Lab, Higher Institiute for Applied Sciences and Technology , Damascus.
+ *
+ *
+ * Author: Rida Takla <raidotakla@gmail.com>
+ */
+#ifndef COGNITIVE_NCCI_HEADER
+#define COGNITIVE_NCCI_HEADER
+
+#include "cognitive-control-message.h"
+#include "cognitive-mac-key.h"
+
+#include <ns3/header.h>
+#include <ns3/address.h>
+
+#include <map>
+#include <set>
+
+namespace ns3
+{
+
+/**
+ * this class is the serialized form of the NCCI
+ * message, a full refresh carries all the tables
+ * and a delta carries the entries changed since
+ * the full refresh of the same epoch, the channel
+ * ids are varints and the Q values are quantized
+ */
+
+class CognitiveNcciHeader : public Header
+{
+    public:
+      static const uint32_t QScale = 256;   //!< the Q values are sent as round(Q*QScale)
+
+      CognitiveNcciHeader();
+
+      ~CognitiveNcciHeader() override;
+
+      /**
+       * Register this type
+       * @return the type ID
+       */
+      static TypeId GetTypeId();
+
+      TypeId GetInstanceTypeId() const override;
+
+      void Print(std::ostream& os) const override;
+
+      uint32_t GetSerializedSize() const override;
+
+      void Serialize(Buffer::Iterator start) const override;
+
+      uint32_t Deserialize(Buffer::Iterator start) override;
+
+      /**
+       * @brief fill the header with
+       * all the tables
+       * @param tables the tables of the sender
+       * @param epoch the number of the full refresh
+       * @param energy the remaining energy
+       */
+      void SetFull(const NcciTables& tables, uint32_t epoch, double energy);
+
+      /**
+       * @brief fill the header with the entries
+       * changed since the full refresh
+       * @param base the tables sent in the full refresh
+       * @param tables the current tables of the sender
+       * @param epoch the number of the full refresh
+       * @param energy the remaining energy
+       */
+      void SetDelta(const NcciTables& base, const NcciTables& tables,
+                    uint32_t epoch, double energy);
+
+      /**
+       * @brief apply the header on the tables,
+       * a full refresh replaces them and a
+       * delta changes the base tables
+       * @param tables the tables to change
+       */
+      void Apply(NcciTables& tables) const;
+
+      /**
+       * @brief is it a full refresh
+       * @return true for a full refresh
+       */
+      bool IsFull() const;
+
+      /**
+       * @brief was the received header well formed,
+       * a truncated header or an address longer than
+       * an Address is rejected and applies nothing
+       * @return true if the header is valid
+       */
+      bool IsValid() const;
+
+      /**
+       * @brief get the number of the
+       * full refresh
+       * @return the epoch
+       */
+      uint32_t GetEpoch() const;
+
+      /**
+       * @brief get the remaining
+       * energy of the sender
+       * @return the energy
+       */
+      double GetEnergy() const;
+
+    private:
+
+      /**
+       * @brief quantize a Q value
+       * @param q the Q value
+       * @return round(q*QScale)
+       */
+      static int64_t Quantize(double q);
+
+      bool m_full;                                                  //!< true for a full refresh
+      bool m_valid;                                                 //!< false if the received header was malformed
+      uint32_t m_epoch;                                             //!< the number of the full refresh
+      uint64_t m_energy;                                            //!< the remaining energy in milli joules
+
+      std::map<uint16_t,int64_t> m_quality;                         //!< added or changed channels and their quantized Q
+      std::set<uint16_t> m_removedChannels;                         //!< channels not available anymore
+      // ordered by the key so the same tables always give the same bytes
+      std::map<MacKey,std::set<uint16_t>> m_neighbors;              //!< added or changed neighbors and their channels
+      std::set<MacKey> m_removedNeighbors;                          //!< neighbors not reachable anymore
+      std::map<MacKey,std::pair<uint16_t,uint16_t>> m_clusters;     //!< added or changed clusters and their CADC,CBDC
+      std::set<MacKey> m_removedClusters;                           //!< clusters not reachable anymore
+};
+
+}
+
+#endif // COGNITIVE_NCCI_HEADER
@@ -7,7 +7,14 @@
 
 #include "cognitive-routing-unite.h"
 
+#include <ns3/boolean.h>
+#include <ns3/double.h>
 #include <ns3/simulator.h>
+#include <ns3/uinteger.h>
+#include <ns3/enum.h>
+#include <ns3/trace-source-accessor.h>
+
+#include <algorithm>
 
 namespace ns3
 {
@@ -21,15 +28,30 @@ CognitiveRoutingUnite::CognitiveRoutingUnite():
     m_routingEnabled(false),
     m_ImClusterHead(false),
     m_ImGateway(false),
+    m_routeLifetime(Seconds(2.5)),
+    m_refreshLead(Seconds(0.5)),
+    m_maxPaths(3),
+    m_pathStretch(1.5),
+    m_multipathPolicy(FLOW_HASH),
+    m_localRepair(true),
+    m_repairTimeout(Seconds(0.5)),
+    m_proactive(false),
+    m_vectorPeriod(Seconds(1)),
+    m_maxClusterHops(16),
+    m_vectorSeq(0),
+    m_maxPending(64),
+    m_pendingDropPolicy(DROP_NEWEST),
+    m_linkDelayMetric(MEASURED_DELAY),
+    m_requestSeq(0),
+    m_suppressDuplicates(true),
     m_ExpiracyTime(Seconds(0.5))
 {
-    m_vector = new std::vector<Ptr<MacDcfFrame>>();
+
 }
 
 CognitiveRoutingUnite::~CognitiveRoutingUnite()
 {
-    m_vector->clear();
-    m_vector = nullptr;
+
 }
 
 TypeId
@@ -40,7 +62,109 @@ CognitiveRoutingUnite::GetTypeId()
         TypeId("ns3::CognitiveRoutingUnite")
             .SetParent<Object>()
             .SetGroupName("Network")
-            .AddConstructor<CognitiveRoutingUnite>();
+            .AddConstructor<CognitiveRoutingUnite>()
+            .AddAttribute("RouteLifetime",
+                          "The validity of a route after its route reply",
+                          TimeValue(Seconds(2.5)),
+                          MakeTimeAccessor(&CognitiveRoutingUnite::m_routeLifetime),
+                          MakeTimeChecker())
+            .AddAttribute("RouteRefreshLead",
+                          "How long before its expiracy a route in use is rediscovered "
+                          "in the background, zero disables the refresh",
+                          TimeValue(Seconds(0.5)),
+                          MakeTimeAccessor(&CognitiveRoutingUnite::m_refreshLead),
+                          MakeTimeChecker())
+            .AddAttribute("MaxPaths",
+                          "The maximum number of next hops kept for one destination",
+                          UintegerValue(3),
+                          MakeUintegerAccessor(&CognitiveRoutingUnite::m_maxPaths),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("PathDelayStretch",
+                          "A next hop is kept only if the delay through it is at most "
+                          "this factor times the delay of the best one",
+                          DoubleValue(1.5),
+                          MakeDoubleAccessor(&CognitiveRoutingUnite::m_pathStretch),
+                          MakeDoubleChecker<double>(1.0))
+            .AddAttribute("MultipathPolicy",
+                          "The way the flows to a destination are spread over its next hops",
+                          EnumValue(CognitiveRoutingUnite::FLOW_HASH),
+                          MakeEnumAccessor<MultipathPolicy>(&CognitiveRoutingUnite::m_multipathPolicy),
+                          MakeEnumChecker(CognitiveRoutingUnite::FLOW_HASH, "FlowHash",
+                                          CognitiveRoutingUnite::WEIGHTED_ROUND_ROBIN, "WeightedRoundRobin"))
+            .AddAttribute("LocalRepair",
+                          "Cluster heads and gateways rediscover a broken route before "
+                          "sending a route error upstream",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&CognitiveRoutingUnite::m_localRepair),
+                          MakeBooleanChecker())
+            .AddAttribute("RepairTimeout",
+                          "The time a local repair waits for a route reply",
+                          TimeValue(Seconds(0.5)),
+                          MakeTimeAccessor(&CognitiveRoutingUnite::m_repairTimeout),
+                          MakeTimeChecker())
+            .AddAttribute("MaxPendingPackets",
+                          "The maximum number of packets waiting for a route to one destination",
+                          UintegerValue(64),
+                          MakeUintegerAccessor(&CognitiveRoutingUnite::m_maxPending),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("PendingDropPolicy",
+                          "The packet dropped when the pending queue of a destination is full",
+                          EnumValue(CognitiveRoutingUnite::DROP_NEWEST),
+                          MakeEnumAccessor<PendingDropPolicy>(&CognitiveRoutingUnite::m_pendingDropPolicy),
+                          MakeEnumChecker(CognitiveRoutingUnite::DROP_NEWEST, "DropNewest",
+                                          CognitiveRoutingUnite::DROP_OLDEST, "DropOldest"))
+            .AddAttribute("LinkDelayMetric",
+                          "The delay of a link used to select the routes",
+                          EnumValue(CognitiveRoutingUnite::MEASURED_DELAY),
+                          MakeEnumAccessor<LinkDelayMetric>(&CognitiveRoutingUnite::m_linkDelayMetric),
+                          MakeEnumChecker(CognitiveRoutingUnite::ANALYTICAL_DELAY, "Analytical",
+                                          CognitiveRoutingUnite::MEASURED_DELAY, "Measured"))
+            .AddAttribute("ProactiveMode",
+                          "Cluster heads exchange cluster distance vectors and their member "
+                          "lists, so known destinations are routed without a discovery",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&CognitiveRoutingUnite::m_proactive),
+                          MakeBooleanChecker())
+            .AddAttribute("ClusterVectorPeriod",
+                          "The period of the cluster distance vectors, the learnt routes "
+                          "become stale after three periods",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&CognitiveRoutingUnite::m_vectorPeriod),
+                          MakeTimeChecker())
+            .AddAttribute("MaxClusterHops",
+                          "The number of clusters after which an advertised cluster and its "
+                          "members are ignored, it bounds the clusters whose members are resolved",
+                          UintegerValue(16),
+                          MakeUintegerAccessor(&CognitiveRoutingUnite::m_maxClusterHops),
+                          MakeUintegerChecker<uint16_t>(1))
+            .AddAttribute("DuplicateCacheSize",
+                          "The number of route requests remembered to drop their duplicates",
+                          UintegerValue(256),
+                          MakeUintegerAccessor(&CognitiveRoutingUnite::SetDuplicateCacheSize,
+                                               &CognitiveRoutingUnite::GetDuplicateCacheSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("SuppressDuplicateRequests",
+                          "Cluster heads and gateways don't rebroadcast a route request already "
+                          "in their cache, false only counts the duplicates to measure the cache",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&CognitiveRoutingUnite::m_suppressDuplicates),
+                          MakeBooleanChecker())
+            .AddTraceSource("PendingDrop",
+                            "A packet waiting for a route was dropped because its queue was full",
+                            MakeTraceSourceAccessor(&CognitiveRoutingUnite::m_pendingDropTrace),
+                            "ns3::Packet::TracedCallback")
+            .AddTraceSource("PendingQueueDepth",
+                            "The number of packets waiting for a route to a destination",
+                            MakeTraceSourceAccessor(&CognitiveRoutingUnite::m_pendingDepthTrace),
+                            "ns3::CognitiveRoutingUnite::PendingDepthTracedCallback")
+            .AddTraceSource("DiscoveryDelay",
+                            "A packet was sent after waiting for a route discovery",
+                            MakeTraceSourceAccessor(&CognitiveRoutingUnite::m_discoveryDelayTrace),
+                            "ns3::CognitiveRoutingUnite::PacketDelayTracedCallback")
+            .AddTraceSource("Delivered",
+                            "A packet reached its final destination, with its end to end latency",
+                            MakeTraceSourceAccessor(&CognitiveRoutingUnite::m_deliveredTrace),
+                            "ns3::CognitiveRoutingUnite::PacketDelayTracedCallback");
     return tid;
 }
 
@@ -53,13 +177,17 @@ CognitiveRoutingUnite::GetSimulationResults()
     std::cout << "Total Delay " << TotDelay << '\n';
     std::cout << "Total Number of Sent Routing Bytes " << RoutingBytes << '\n';
     std::cout << "Total Number of Sent Control Bytes " << ControlBytes << '\n';
+    std::cout << "Total Number of Dropped Pending Packets " << PendingDrops << '\n';
+    std::cout << "Total Number of Duplicate Route Requests " << DuplicateRequests << '\n';
+    std::cout << "Total Number of Rebroadcast Duplicate Route Requests " << DuplicateRebroadcasts << '\n';
 }
 
 void
 
 CognitiveRoutingUnite::DoDispose()
 {
-    m_vector = nullptr; 
+    m_vectorEvent.Cancel();
+    m_pending.clear();
     Object::DoDispose();
 }
 
@@ -88,15 +216,16 @@ CognitiveRoutingUnite::SendPacket(Ptr<Packet> packet, const Address source, cons
         if(m_routingEnabled)
         {
             SentPackets++;
-            if(m_routingTable.count(dest))
+            Address nextHop;
+            if(LookupRoute(source,dest,nextHop) || ProactiveRoute(dest,nextHop))
             {
-                frame->SetCurrentReceiver(Mac48Address::ConvertFrom(m_routingTable[dest]));
+                frame->SetCurrentReceiver(Mac48Address::ConvertFrom(nextHop));
                 this->SendFrame(frame);
-                std::cout << m_address << ' ' << packet->GetUid() << '\n';
+                NS_LOG_INFO(m_address << ' ' << packet->GetUid());
             }
             else
             {
-                m_vector->push_back(frame);
+                EnqueuePending(frame,dest);
                 if(!m_requiredAddresses.count(dest))
                 {
                     Simulator::ScheduleNow(&CognitiveRoutingUnite::StartRouteDiscovery,this,dest);\
@@ -138,6 +267,14 @@ CognitiveRoutingUnite::ReceiveFrame(Ptr<MacDcfFrame> frame)
             {
                 Simulator::ScheduleNow(&CognitiveRoutingUnite::ReceiveRouteReply,this,routFrame);
             }
+            else if(routFrame->GetMsgType()==RErr)
+            {
+                Simulator::ScheduleNow(&CognitiveRoutingUnite::ReceiveRouteError,this,routFrame);
+            }
+            else if(routFrame->GetMsgType()==CDV)
+            {
+                Simulator::ScheduleNow(&CognitiveRoutingUnite::ReceiveClusterVector,this,routFrame);
+            }
         }
         else
         {
@@ -146,11 +283,12 @@ CognitiveRoutingUnite::ReceiveFrame(Ptr<MacDcfFrame> frame)
     }
     else
     {
-        std::cout << currentReceiver << ' '<< orignalReceiver << ' ' << frame->GetPacket()->GetUid() << '\n';   
+        NS_LOG_INFO(currentReceiver << ' ' << orignalReceiver << ' ' << frame->GetPacket()->GetUid());
         if(orignalReceiver==m_address)
         {
             ReceivedPackets++;
             TotDelay+= frame->CalculateLatency();
+            m_deliveredTrace(frame->GetPacket(),frame->CalculateLatency());
             return;
         }
         else
@@ -158,17 +296,22 @@ CognitiveRoutingUnite::ReceiveFrame(Ptr<MacDcfFrame> frame)
             
             if(m_routingEnabled)
             {
-                if(m_routingTable.count(orignalReceiver))
+                Address nextHop;
+                bool discovered = LookupRoute(Mac48Address::ConvertFrom(frame->GetOriginalSender()),orignalReceiver,nextHop);
+                if(discovered)
+                {
+                    m_routingTable[orignalReceiver].precursors.insert(Mac48Address::ConvertFrom(frame->GetCurrentSender()));
+                }
+                if(discovered || ProactiveRoute(orignalReceiver,nextHop))
                 {
-                    
-                    frame->SetCurrentReceiver(Mac48Address::ConvertFrom(m_routingTable[orignalReceiver]));
+                    frame->SetCurrentReceiver(Mac48Address::ConvertFrom(nextHop));
                     frame->SetCurrentSender(Mac48Address::ConvertFrom(m_address));
                     m_dataFrameCallback(frame);
                 }
                 else
                 {
                     frame->SetCurrentSender(Mac48Address::ConvertFrom(m_address));
-                    m_vector->push_back(frame);
+                    EnqueuePending(frame,orignalReceiver);
                     if(!m_requiredAddresses.count(orignalReceiver))
                     {
                         StartRouteDiscovery(orignalReceiver);
@@ -255,6 +398,48 @@ CognitiveRoutingUnite::NumReceivedPackets()
     return ReceivedPackets;
 }
 
+uint32_t
+
+CognitiveRoutingUnite::NumRoutingBytes()
+{
+    return RoutingBytes;
+}
+
+uint32_t
+
+CognitiveRoutingUnite::NumDuplicateRequests()
+{
+    return DuplicateRequests;
+}
+
+uint32_t
+
+CognitiveRoutingUnite::NumDuplicateRebroadcasts()
+{
+    return DuplicateRebroadcasts;
+}
+
+void
+
+CognitiveRoutingUnite::SetDuplicateCacheSize(uint32_t size)
+{
+    m_requestCache.SetCapacity(size);
+}
+
+uint32_t
+
+CognitiveRoutingUnite::GetDuplicateCacheSize() const
+{
+    return m_requestCache.GetCapacity();
+}
+
+void
+
+CognitiveRoutingUnite::SetLinkStatsCallback(LinkStatsCallback c)
+{
+    m_linkStatsCallback = c;
+}
+
 void
 
 CognitiveRoutingUnite::SetAddress(const Address address)
@@ -299,9 +484,20 @@ CognitiveRoutingUnite::SetNumberOfNeighboringNodesCallback(NumberOfNeighbors c)
 
 void
 
+CognitiveRoutingUnite::SetClusterMembersCallback(ClusterMembersCallback c)
+{
+    m_clusterMembersCallback = c;
+}
+
+void
+
 CognitiveRoutingUnite::SetClusterHeadStatus(bool b)
 {
     m_ImClusterHead = b;
+    if(m_ImClusterHead && m_proactive && !m_vectorEvent.IsPending())
+    {
+        m_vectorEvent = Simulator::ScheduleNow(&CognitiveRoutingUnite::SendClusterVector,this);
+    }
 }
 
 void 
@@ -319,7 +515,7 @@ CognitiveRoutingUnite::StartRouteDiscovery(Address address)
     {
         return ;
     }
-    if(m_pendingReq.count(std::make_pair(m_address,address)))
+    if(m_pendingReq.count(std::make_pair(MacKey(m_address),MacKey(address))))
     {
         return ;
     }
@@ -333,7 +529,10 @@ CognitiveRoutingUnite::StartRouteDiscovery(Address address)
     msg->SetOriginalSender(Mac48Address::ConvertFrom(m_address));
     msg->SetPacket(pkt);
     msg->SetProtocolNumber(routingProtocol);
-    m_pendingReq.insert(std::make_pair(m_address,address));
+    msg->SetRequestId(Mac48Address::ConvertFrom(m_address),++m_requestSeq);
+    m_requestCache.Insert(m_address,m_requestSeq);
+    m_pendingReq.insert(std::make_pair(MacKey(m_address),MacKey(address)));
+    Simulator::Schedule(m_ExpiracyTime,&CognitiveRoutingUnite::DeleteRequest,this,m_address,address);
     if(m_CHaddress!=m_address)
     {
         msg->SetOriginalReceiver(Mac48Address::ConvertFrom(m_CHaddress));
@@ -355,8 +554,14 @@ CognitiveRoutingUnite::ReceiveRouteDiscoveryRequest(Ptr<MacDcfFrame> frame)
     GetInfos("Receive Route Request");
     Address des = frame->GetRequiredAddress();
     Address src = Mac48Address::ConvertFrom(frame->GetOriginalSender());
+    bool duplicate = !m_requestCache.Insert(frame->GetRequestOriginator(),frame->GetRequestSequence());
+    if(duplicate)
+    {
+        DuplicateRequests++;
+    }
     if(m_address==des)
     {
+        // every copy comes from a different upstream hop and gives another path
         GetInfos("Send Route Reply");
         Ptr<Packet> pkt = Create<Packet>(RRepSize);
         Ptr<MacDcfFrame> msg = CreateObject<MacDcfFrame>();
@@ -374,16 +579,27 @@ CognitiveRoutingUnite::ReceiveRouteDiscoveryRequest(Ptr<MacDcfFrame> frame)
 
         return;
     }
-    if(m_pendingReq.count(std::make_pair(src,des)))
+    if(frame->GetRequestOriginator()==Mac48Address::ConvertFrom(m_address))
+    {
+        // our own request looped back
+        return;
+    }
+    if(m_pendingReq.count(std::make_pair(MacKey(src),MacKey(des))))
     {
         return;
     }
     if(m_ImClusterHead || m_ImGateway)
     {
-       m_pendingReq.insert(std::make_pair(src,des));
+       m_pendingReq.insert(std::make_pair(MacKey(src),MacKey(des)));
+       Simulator::Schedule(m_ExpiracyTime,&CognitiveRoutingUnite::DeleteRequest,this,src,des);
        GetInfos("Send Route Request");
-        if(!m_requiredAddresses.count(des))
+        // the reply still goes back to every requester, only the flood is suppressed
+        if((!duplicate || !m_suppressDuplicates) && !m_requiredAddresses.count(des))
         {
+            if(duplicate)
+            {
+                DuplicateRebroadcasts++;
+            }
             m_requiredAddresses.insert(des);
             Ptr<Packet> pkt = Create<Packet>(RReqSize);
             Ptr<MacDcfFrame> msg = CreateObject<MacDcfFrame>();
@@ -396,8 +612,8 @@ CognitiveRoutingUnite::ReceiveRouteDiscoveryRequest(Ptr<MacDcfFrame> frame)
             msg->SetOriginalReceiver(Mac48Address::ConvertFrom(Broadcast));
             msg->SetCurrentReceiver(Mac48Address::ConvertFrom(Broadcast));
             msg->SetProtocolNumber(routingProtocol);
+            msg->SetRequestId(frame->GetRequestOriginator(),frame->GetRequestSequence());
             this->SendFrame(msg);
-            Simulator::Schedule(m_ExpiracyTime,&CognitiveRoutingUnite::DeleteRequest,this,src,des);
         }
         else
         {
@@ -417,29 +633,43 @@ CognitiveRoutingUnite::ReceiveRouteReply(Ptr<MacDcfFrame> frame)
 {
     GetInfos("Receive Route Reply");
     Address des = frame->GetRequiredAddress();
-    double delay = CalculateLinkDelay() + frame->GetDelay();
-    if(!m_minDelay.count(des))
+    Address sender = Mac48Address::ConvertFrom(frame->GetCurrentSender());
+    double delay = CalculateLinkDelay(sender) + frame->GetDelay();
+    auto route = m_routingTable.find(des);
+    bool fresh = route==m_routingTable.end() || route->second.refreshing;
+    RouteEntry& entry = m_routingTable[des];
+    if(fresh)
     {
-        m_minDelay[des] = delay ;
-        m_routingTable[des] = Mac48Address::ConvertFrom(frame->GetCurrentSender());
-        m_timers[des].Cancel();
-        m_timers[des] = Simulator::Schedule(m_ExpiracyTime*5,&CognitiveRoutingUnite::DeleteNode,this,des);
+        // the first reply of a refresh replaces the old next hops
+        entry.paths.clear();
     }
-    else
+    auto repair = m_repairs.find(des);
+    if(repair!=m_repairs.end())
+    {
+        GetInfos("Route Repaired");
+        entry.precursors.insert(repair->second.begin(),repair->second.end());
+        m_repairs.erase(repair);
+    }
+    if(AddPath(entry,sender,delay) && (fresh || entry.paths.front().nextHop==sender))
     {
-        if(m_minDelay[des] > delay)
+        // a new or better best path renews the route, alternatives share its lifetime
+        entry.installed = Simulator::Now();
+        entry.refreshing = false;
+        entry.expire.Cancel();
+        entry.expire = Simulator::Schedule(m_routeLifetime,&CognitiveRoutingUnite::DeleteNode,this,des);
+        entry.refresh.Cancel();
+        if(m_refreshLead.IsStrictlyPositive() && m_routeLifetime > m_refreshLead)
         {
-            m_minDelay[des] = delay;
-            m_routingTable[des] = Mac48Address::ConvertFrom(frame->GetCurrentSender());
-            m_timers[des].Cancel();
-            m_timers[des] = Simulator::Schedule(m_ExpiracyTime*5,&CognitiveRoutingUnite::DeleteNode,this,des);
+            entry.refresh = Simulator::Schedule(m_routeLifetime-m_refreshLead,
+                                                &CognitiveRoutingUnite::RefreshRoute,this,des);
         }
     }
-    SendPendingPackets();
+    SendPendingPackets(des);
     for(auto& [i,j] : m_pendingReq)
     {
         if(j==des && i!=m_address)
         {
+            m_routingTable[des].precursors.insert(i);
             GetInfos("Sending Route Reply");
             Ptr<Packet> pkt = Create<Packet> (RRepSize);
             Ptr<MacDcfFrame> msg = CreateObject<MacDcfFrame>();
@@ -449,8 +679,8 @@ CognitiveRoutingUnite::ReceiveRouteReply(Ptr<MacDcfFrame> frame)
             msg->SetRequiredAddress(des);
             msg->SetOriginalSender(Mac48Address::ConvertFrom(m_address));
             msg->SetCurrentSender(Mac48Address::ConvertFrom(m_address));
-            msg->SetOriginalReceiver(Mac48Address::ConvertFrom(i)); 
-            msg->SetCurrentReceiver(Mac48Address::ConvertFrom(i));
+            msg->SetOriginalReceiver(Mac48Address::ConvertFrom(i.GetAddress())); 
+            msg->SetCurrentReceiver(Mac48Address::ConvertFrom(i.GetAddress()));
             msg->SetDelay(delay);
             msg->SetProtocolNumber(routingProtocol);
             this->SendFrame(msg);   
@@ -460,8 +690,9 @@ CognitiveRoutingUnite::ReceiveRouteReply(Ptr<MacDcfFrame> frame)
 
 void
 
-CognitiveRoutingUnite::SendRouteError(Address address)
+CognitiveRoutingUnite::SendRouteError(Address des, Address address)
 {
+    GetInfos("Send Route Error");
     Ptr<Packet> pkt = Create<Packet>(RErrSize);
     Ptr<MacDcfFrame> msg = CreateObject<MacDcfFrame>();
     msgs[pkt->GetUid()] = msg ;
@@ -470,58 +701,475 @@ CognitiveRoutingUnite::SendRouteError(Address address)
     msg->SetCurrentSender(Mac48Address::ConvertFrom(m_address));
     msg->SetOriginalReceiver(Mac48Address::ConvertFrom(address));
     msg->SetCurrentReceiver(Mac48Address::ConvertFrom(address));
+    msg->SetRequiredAddress(des);
     msg->SetMsgType(RoutingMsgType::RErr);
+    msg->SetProtocolNumber(routingProtocol);
     this->SendFrame(msg);
 }
 
 void
 
-CognitiveRoutingUnite::ReceiveRouteError(Ptr<MacDcfFrame> fra)
+CognitiveRoutingUnite::ReceiveRouteError(Ptr<MacDcfFrame> frame)
 {
-    Ptr<MacDcfFrame> frame = msgs[fra->GetPacket()->GetUid()];
-    if(m_address==frame->GetRequiredAddress())
+    GetInfos("Receive Route Error");
+    Address des = frame->GetRequiredAddress();
+    Address sender = Mac48Address::ConvertFrom(frame->GetCurrentSender());
+    auto route = m_routingTable.find(des);
+    if(route==m_routingTable.end())
     {
-        StartRouteDiscovery(frame->GetRequiredAddress());
+        return;
     }
-    else
+    // only the path through the sender is broken, the others keep the flows
+    auto& paths = route->second.paths;
+    paths.erase(std::remove_if(paths.begin(),paths.end(),
+                               [&](const RoutePath& p){ return p.nextHop==sender; }),
+                paths.end());
+    if(paths.empty())
     {
-        Address prevHop = m_routingTable[frame->GetRequiredAddress()];
-        this->SendRouteError(prevHop);
+        RouteLost(des);
     }
 }
 
-void 
+void
+
+CognitiveRoutingUnite::NotifyLinkFailure(Ptr<MacDcfFrame> frame)
+{
+    Address nextHop = Mac48Address::ConvertFrom(frame->GetCurrentReceiver());
+    GetInfos("Link Failure");
+    DeleteNextHop(nextHop);
+    if(frame->GetProtocolNumber()!=1)
+    {
+        return;
+    }
+    // salvage the dropped packet over another path or keep it for the repair
+    Address des = Mac48Address::ConvertFrom(frame->GetOriginalReceiver());
+    Address route;
+    if(LookupRoute(Mac48Address::ConvertFrom(frame->GetOriginalSender()),des,route))
+    {
+        frame->SetCurrentReceiver(Mac48Address::ConvertFrom(route));
+        m_dataFrameCallback(frame);
+    }
+    else if(m_repairs.count(des) || frame->GetOriginalSender()==Mac48Address::ConvertFrom(m_address))
+    {
+        EnqueuePending(frame,des);
+        if(!m_requiredAddresses.count(des))
+        {
+            StartRouteDiscovery(des);
+        }
+    }
+}
+
+void
 
-CognitiveRoutingUnite::SendPendingPackets()
+CognitiveRoutingUnite::RouteLost(Address des)
 {
-    int j = 0 ; 
-    std::vector<Ptr<MacDcfFrame>> vect;
-    for(auto& frame : *m_vector)
+    auto route = m_routingTable.find(des);
+    if(route==m_routingTable.end())
     {
-        Address des = Mac48Address::ConvertFrom(frame->GetOriginalReceiver());
-        if(m_routingTable.count(des))
+        return;
+    }
+    MacKeySet precursors;
+    precursors.swap(route->second.precursors);
+    DeleteNode(des);
+    if(m_localRepair && (m_ImClusterHead || m_ImGateway) && !precursors.empty())
+    {
+        GetInfos("Local Repair");
+        m_repairs[des].insert(precursors.begin(),precursors.end());
+        Simulator::Schedule(m_repairTimeout,&CognitiveRoutingUnite::RepairTimeout,this,des);
+        StartRouteDiscovery(des);
+        return;
+    }
+    for(auto& precursor : precursors)
+    {
+        SendRouteError(des,precursor.GetAddress());
+    }
+}
+
+void
+
+CognitiveRoutingUnite::RepairTimeout(Address des)
+{
+    auto repair = m_repairs.find(des);
+    if(repair==m_repairs.end())
+    {
+        return;
+    }
+    MacKeySet precursors;
+    precursors.swap(repair->second);
+    m_repairs.erase(repair);
+    for(auto& precursor : precursors)
+    {
+        SendRouteError(des,precursor.GetAddress());
+    }
+    auto bucket = m_pending.find(des);
+    if(bucket!=m_pending.end())
+    {
+        for(auto& [arrival,frame] : bucket->second)
         {
-            j++;
-            frame->SetCurrentReceiver(Mac48Address::ConvertFrom(m_routingTable[des]));
-            m_dataFrameCallback(frame);
+            PendingDrops++;
+            m_pendingDropTrace(frame->GetPacket());
         }
-        else
+        m_pending.erase(bucket);
+        m_pendingDepthTrace(des,0);
+    }
+}
+
+void
+
+CognitiveRoutingUnite::SendClusterVector()
+{
+    if(!m_ImClusterHead || !m_proactive)
+    {
+        return;
+    }
+    std::vector<ClusterVectorEntry> vector;
+    vector.push_back(ClusterVectorEntry{m_address,0.0,0,++m_vectorSeq,{}});
+    if(!m_clusterMembersCallback.IsNull())
+    {
+        vector.back().members = m_clusterMembersCallback();
+    }
+    // the members learnt from the other heads go with their cluster, so the heads
+    // beyond the neighboring clusters resolve them too
+    MacKeyMap<std::vector<Address>> members;
+    for(auto& [member,membership] : m_clusterOf)
+    {
+        if(membership.expire > Simulator::Now())
         {
-            vect.push_back(frame);
+            members[membership.clusterHead].push_back(member.GetAddress());
         }
     }
-    *m_vector = vect ;
+    uint32_t memberCount = vector.back().members.size();
+    for(auto& [cluster,route] : m_clusterRoutes)
+    {
+        if(route.expire > Simulator::Now())
+        {
+            vector.push_back(ClusterVectorEntry{cluster.GetAddress(),route.delay,route.hops,route.seq,{}});
+            auto known = members.find(cluster);
+            if(known!=members.end())
+            {
+                vector.back().members = known->second;
+                memberCount += known->second.size();
+            }
+        }
+    }
+    GetInfos("Send Cluster Vector");
+    Ptr<Packet> pkt = Create<Packet>(CDVsize + vector.size()*CDVEntrySize + memberCount*CDVMemberSize);
+    Ptr<MacDcfFrame> msg = CreateObject<MacDcfFrame>();
+    msgs[pkt->GetUid()] = msg;
+    msg->SetPacket(pkt);
+    msg->SetMsgType(RoutingMsgType::CDV);
+    msg->SetOriginalSender(Mac48Address::ConvertFrom(m_address));
+    msg->SetCurrentSender(Mac48Address::ConvertFrom(m_address));
+    msg->SetOriginalReceiver(Mac48Address::ConvertFrom(Broadcast));
+    msg->SetCurrentReceiver(Mac48Address::ConvertFrom(Broadcast));
+    msg->SetProtocolNumber(routingProtocol);
+    msg->SetRequestId(Mac48Address::ConvertFrom(m_address),m_vectorSeq);
+    msg->SetClusterVector(vector);
+    m_vectorCache.Insert(m_address,m_vectorSeq);
+    this->SendFrame(msg);
+    m_vectorEvent = Simulator::Schedule(m_vectorPeriod,&CognitiveRoutingUnite::SendClusterVector,this);
+}
+
+void
+
+CognitiveRoutingUnite::ReceiveClusterVector(Ptr<MacDcfFrame> frame)
+{
+    if(!m_proactive || !(m_ImClusterHead || m_ImGateway))
+    {
+        // the members send everything to their cluster head
+        return;
+    }
+    Address origin = frame->GetRequestOriginator();
+    if(!m_vectorCache.Insert(origin,frame->GetRequestSequence()))
+    {
+        return;
+    }
+    Address sender = Mac48Address::ConvertFrom(frame->GetCurrentSender());
+    double link = CalculateLinkDelay(sender);
+    Time expire = Simulator::Now() + 3*m_vectorPeriod;
+    std::vector<ClusterVectorEntry> relayed;
+    for(auto& entry : frame->GetClusterVector())
+    {
+        if(entry.clusterHead==m_address || entry.hops >= m_maxClusterHops)
+        {
+            continue;
+        }
+        double delay = entry.delay + link;
+        relayed.push_back(ClusterVectorEntry{entry.clusterHead,delay,entry.hops,entry.seq,entry.members});
+        if(IsBetterClusterRoute(m_clusterRoutes,entry.clusterHead,entry.seq,delay))
+        {
+            m_clusterRoutes[entry.clusterHead] = ClusterRoute{sender,delay,uint16_t(entry.hops+1),expire,entry.seq};
+        }
+        // the members of an older vector may have moved to another cluster since
+        if(m_clusterRoutes[entry.clusterHead].seq==entry.seq)
+        {
+            for(auto& member : entry.members)
+            {
+                m_clusterOf[member] = ClusterMembership{entry.clusterHead,expire};
+            }
+        }
+    }
+    if(m_ImGateway && !m_ImClusterHead && sender==origin)
+    {
+        // carry the vector of a neighboring head one hop further, to the next cluster head
+        Ptr<Packet> pkt = Create<Packet>(frame->GetPacket()->GetSize());
+        Ptr<MacDcfFrame> msg = CreateObject<MacDcfFrame>();
+        msgs[pkt->GetUid()] = msg;
+        msg->SetPacket(pkt);
+        msg->SetMsgType(RoutingMsgType::CDV);
+        msg->SetOriginalSender(frame->GetOriginalSender());
+        msg->SetCurrentSender(Mac48Address::ConvertFrom(m_address));
+        msg->SetOriginalReceiver(Mac48Address::ConvertFrom(Broadcast));
+        msg->SetCurrentReceiver(Mac48Address::ConvertFrom(Broadcast));
+        msg->SetProtocolNumber(routingProtocol);
+        msg->SetRequestId(frame->GetRequestOriginator(),frame->GetRequestSequence());
+        msg->SetClusterVector(relayed);
+        this->SendFrame(msg);
+    }
+}
+
+bool
+
+CognitiveRoutingUnite::IsBetterClusterRoute(const MacKeyMap<ClusterRoute>& routes,
+                                            Address head,
+                                            uint32_t seq,
+                                            double delay)
+{
+    auto route = routes.find(head);
+    if(route==routes.end())
+    {
+        return true;
+    }
+    // a vector echoed back from an older round can't replace a fresher route, this stops the count to infinity
+    int32_t age = static_cast<int32_t>(seq - route->second.seq);
+    if(age!=0)
+    {
+        return age > 0;
+    }
+    return route->second.expire > Simulator::Now() && delay < route->second.delay;
+}
+
+bool
+
+CognitiveRoutingUnite::ProactiveRoute(Address des, Address& nextHop)
+{
+    if(!m_proactive || !m_IhaveCluster)
+    {
+        return false;
+    }
+    if(!m_ImClusterHead && !m_ImGateway)
+    {
+        // the cluster head resolves the destination
+        nextHop = m_CHaddress;
+        return m_CHaddress!=m_address;
+    }
+    if(m_ImClusterHead && !m_IsClusterMemberCallback.IsNull() && m_IsClusterMemberCallback(des))
+    {
+        nextHop = des;
+        return true;
+    }
+    auto membership = m_clusterOf.find(des);
+    Address head = des;
+    if(membership!=m_clusterOf.end() && membership->second.expire > Simulator::Now())
+    {
+        head = membership->second.clusterHead;
+    }
+    if(head==m_address)
+    {
+        nextHop = des;
+        return true;
+    }
+    auto route = m_clusterRoutes.find(head);
+    if(route==m_clusterRoutes.end() || route->second.expire <= Simulator::Now())
+    {
+        return false;
+    }
+    nextHop = route->second.nextHop;
+    return true;
+}
+
+bool
+
+CognitiveRoutingUnite::LookupRoute(Address src, Address des, Address& nextHop)
+{
+    auto route = m_routingTable.find(des);
+    if(route==m_routingTable.end() || route->second.paths.empty())
+    {
+        return false;
+    }
+    route->second.lastUsed = Simulator::Now();
+    nextHop = SelectPath(route->second,src,des);
+    return true;
+}
+
+Address
+
+CognitiveRoutingUnite::SelectPath(RouteEntry& entry, Address src, Address des)
+{
+    if(entry.paths.size()==1)
+    {
+        return entry.paths.front().nextHop;
+    }
+    if(m_multipathPolicy==FLOW_HASH)
+    {
+        // highest random weight, losing a next hop only moves the flows it carried
+        std::size_t flow = MacKeyPairHash()(std::make_pair(MacKey(src),MacKey(des)));
+        const RoutePath* chosen = nullptr;
+        uint64_t chosenScore = 0;
+        for(auto& path : entry.paths)
+        {
+            uint64_t score = (flow ^ MacKeyHash()(path.nextHop)) * 0x9e3779b97f4a7c15ULL;
+            score ^= score >> 32;
+            if(!chosen || score > chosenScore)
+            {
+                chosen = &path;
+                chosenScore = score;
+            }
+        }
+        return chosen->nextHop;
+    }
+    // smooth weighted round robin, the weight of a next hop is its inverse delay
+    RoutePath* chosen = nullptr;
+    double total = 0;
+    for(auto& path : entry.paths)
+    {
+        double weight = 1.0/path.delay;
+        path.credit += weight;
+        total += weight;
+        if(!chosen || path.credit > chosen->credit)
+        {
+            chosen = &path;
+        }
+    }
+    chosen->credit -= total;
+    return chosen->nextHop;
+}
+
+bool
+
+CognitiveRoutingUnite::AddPath(RouteEntry& entry, Address nextHop, double delay)
+{
+    auto path = std::find_if(entry.paths.begin(),entry.paths.end(),
+                             [&](const RoutePath& p){ return p.nextHop==nextHop; });
+    if(path!=entry.paths.end())
+    {
+        path->delay = delay;
+    }
+    else
+    {
+        if(!entry.paths.empty() && delay > entry.paths.front().delay*m_pathStretch)
+        {
+            return false;
+        }
+        if(entry.paths.size() >= m_maxPaths)
+        {
+            if(entry.paths.back().delay <= delay)
+            {
+                return false;
+            }
+            entry.paths.pop_back();
+        }
+        entry.paths.push_back(RoutePath{nextHop,delay,0.0});
+    }
+    std::stable_sort(entry.paths.begin(),entry.paths.end(),
+                     [](const RoutePath& a, const RoutePath& b){ return a.delay < b.delay; });
+    while(entry.paths.size() > 1 && entry.paths.back().delay > entry.paths.front().delay*m_pathStretch)
+    {
+        entry.paths.pop_back();
+    }
+    return std::any_of(entry.paths.begin(),entry.paths.end(),
+                       [&](const RoutePath& p){ return p.nextHop==nextHop; });
+}
+
+void
+
+CognitiveRoutingUnite::RefreshRoute(Address des)
+{
+    auto route = m_routingTable.find(des);
+    if(route==m_routingTable.end())
+    {
+        return;
+    }
+    if(route->second.lastUsed < route->second.installed)
+    {
+        // not used since the last reply, let it expire
+        return;
+    }
+    route->second.refreshing = true;
+    GetInfos("Refresh Route");
+    StartRouteDiscovery(des);
+}
+
+void
+
+CognitiveRoutingUnite::EnqueuePending(Ptr<MacDcfFrame> frame, Address des)
+{
+    auto& queue = m_pending[des];
+    if(queue.size() >= m_maxPending)
+    {
+        PendingDrops++;
+        if(m_pendingDropPolicy==DROP_NEWEST)
+        {
+            m_pendingDropTrace(frame->GetPacket());
+            return;
+        }
+        m_pendingDropTrace(queue.front().second->GetPacket());
+        queue.pop_front();
+    }
+    queue.push_back(std::make_pair(Simulator::Now(),frame));
+    m_pendingDepthTrace(des,queue.size());
+}
+
+void 
+
+CognitiveRoutingUnite::SendPendingPackets(Address des)
+{
+    auto bucket = m_pending.find(des);
+    if(bucket==m_pending.end())
+    {
+        return;
+    }
+    auto route = m_routingTable.find(des);
+    if(route==m_routingTable.end() || route->second.paths.empty())
+    {
+        return;
+    }
+    std::deque<std::pair<Time,Ptr<MacDcfFrame>>> queue;
+    queue.swap(bucket->second);
+    m_pending.erase(bucket);
+    for(auto& [arrival,frame] : queue)
+    {
+        m_discoveryDelayTrace(frame->GetPacket(),Simulator::Now()-arrival);
+        Address nextHop;
+        LookupRoute(Mac48Address::ConvertFrom(frame->GetOriginalSender()),des,nextHop);
+        frame->SetCurrentReceiver(Mac48Address::ConvertFrom(nextHop));
+        m_dataFrameCallback(frame);
+    }
+    m_pendingDepthTrace(des,0);
 }
 
 double
 
-CognitiveRoutingUnite::CalculateLinkDelay()
+CognitiveRoutingUnite::CalculateLinkDelay(Address nextHop)
 {
+    /** caculating the switching delay */
+    double switchingDelay = 0.006;
+
+    /** the delay measured by the MAC */
+    if(m_linkDelayMetric==MEASURED_DELAY && !m_linkStatsCallback.IsNull())
+    {
+        LinkStats stats = m_linkStatsCallback(nextHop);
+        if(stats.samples)
+        {
+            return switchingDelay+stats.queueDelay+stats.serviceTime;
+        }
+    }
+
     NS_ASSERT_MSG(!m_numberOfNeighborsCallback.IsNull(),"you have to set the callback to get the number of neighboring nodes");
     
     /** calculating the queue delay */
     double numberOfNeighbors = m_numberOfNeighborsCallback();
-    double dataRate = 6000000 ;
+    double dataRate = m_dataRate.GetBitRate() ? m_dataRate.GetBitRate() : 6000000 ;
     double packetSize = 1500*8;
     double queueDelay = packetSize*numberOfNeighbors/dataRate;
     
@@ -539,9 +1187,6 @@ CognitiveRoutingUnite::CalculateLinkDelay()
         }
         backoffDelay+=reachingProbability*(contentionWindowSize-1)/2*0.000009;
     }
-    
-    /** caculating the switching delay */
-    double switchingDelay = 0.006;
 
     /** final answer */
     return switchingDelay+backoffDelay+queueDelay;
@@ -552,7 +1197,7 @@ void
 
 CognitiveRoutingUnite::DeleteRequest(Address a , Address b)
 {
-    m_pendingReq.erase(std::make_pair(a,b));
+    m_pendingReq.erase(std::make_pair(MacKey(a),MacKey(b)));
     m_requiredAddresses.erase(b);
 }
 
@@ -560,15 +1205,42 @@ void
 
 CognitiveRoutingUnite::DeleteNode(Address address)
 {
-    m_routingTable.erase(address);
+    auto route = m_routingTable.find(address);
+    if(route==m_routingTable.end())
+    {
+        return;
+    }
+    route->second.expire.Cancel();
+    route->second.refresh.Cancel();
+    m_routingTable.erase(route);
+}
+
+void
+
+CognitiveRoutingUnite::DeleteNextHop(Address nextHop)
+{
+    std::vector<Address> lost;
+    for(auto& [des,entry] : m_routingTable)
+    {
+        auto path = std::remove_if(entry.paths.begin(),entry.paths.end(),
+                                   [&](const RoutePath& p){ return p.nextHop==nextHop; });
+        entry.paths.erase(path,entry.paths.end());
+        if(entry.paths.empty())
+        {
+            lost.push_back(des.GetAddress());
+        }
+    }
+    for(auto& des : lost)
+    {
+        RouteLost(des);
+    }
 }
 
 void 
 
 CognitiveRoutingUnite::GetInfos(std::string s)
 {
-    std::cout << m_address << ',' << s << ',';
-    std::cout << Simulator::Now().GetSeconds() << '\n';
+    NS_LOG_INFO(m_address << ',' << s << ',' << Simulator::Now().GetSeconds());
 }
 
 }
\ No newline at end of file
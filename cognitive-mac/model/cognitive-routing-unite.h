@@ -9,8 +9,12 @@
 
 
 #include "mac-frames.h"
+#include "cognitive-mac-key.h"
+#include "cognitive-duplicate-cache.h"
 #include <ns3/object.h>
+#include <ns3/traced-callback.h>
 
+#include <deque>
 #include <map>
 #include <vector>
 
@@ -21,9 +25,118 @@ typedef Callback<void,Ptr<MacDcfFrame>> SendFrameCallback;
 typedef Callback<void,Ptr<Packet>> SendPacketCallback;
 typedef Callback<bool,Address> IsClusterMemberCallback;
 typedef Callback<uint16_t> NumberOfNeighbors;
+typedef Callback<std::vector<Address>> ClusterMembersCallback;
+
+/**
+ * the statistics measured by the MAC on the
+ * link to a neighbor, exponentially weighted
+ * averages over the acknowledged frames
+ */
+struct LinkStats
+{
+    double serviceTime = 0.0;   //!< seconds from the head of the queue to the ACK
+    double retries = 0.0;       //!< RTS retries per frame
+    double queueDelay = 0.0;    //!< seconds waiting in the MAC queue
+    uint32_t samples = 0;       //!< number of acknowledged frames
+};
+
+typedef Callback<LinkStats,Address> LinkStatsCallback;
     class CognitiveRoutingUnite : public Object
     {
         public:
+            /**
+             * the policy used when the pending
+             * queue of a destination is full
+             */
+            enum PendingDropPolicy
+            {
+                DROP_NEWEST,    //!< drop the arriving packet
+                DROP_OLDEST     //!< drop the packet waiting the longest
+            };
+
+            /**
+             * TracedCallback signature for the depth
+             * of a pending queue
+             * @param destination the destination of the queue
+             * @param depth the number of waiting packets
+             */
+            typedef void (*PendingDepthTracedCallback)(Address destination, uint32_t depth);
+
+            /**
+             * the delay used for a link
+             * in the route selection
+             */
+            enum LinkDelayMetric
+            {
+                ANALYTICAL_DELAY,   //!< the model of the backoff and the queue
+                MEASURED_DELAY      //!< the statistics measured by the MAC
+            };
+
+            /**
+             * TracedCallback signature for a packet
+             * and a delay it experienced
+             * @param packet the packet
+             * @param delay the delay
+             */
+            typedef void (*PacketDelayTracedCallback)(Ptr<const Packet> packet, Time delay);
+
+            /**
+             * the way the flows to a destination
+             * are spread over its next hops
+             */
+            enum MultipathPolicy
+            {
+                FLOW_HASH,              //!< each flow sticks to a next hop chosen by its hash
+                WEIGHTED_ROUND_ROBIN    //!< the packets rotate over the next hops by inverse delay
+            };
+
+            /**
+             * a next hop to a destination
+             */
+            struct RoutePath
+            {
+                Address nextHop;        //!< the next hop to the destination
+                double delay;           //!< the total delay of the path through it
+                double credit;          //!< the current weight of the smooth round robin
+            };
+
+            /**
+             * a route to a cluster head
+             * learnt from the distance vectors
+             */
+            struct ClusterRoute
+            {
+                Address nextHop;        //!< the next hop to the cluster head
+                double delay;           //!< the delay to the cluster head
+                uint16_t hops;          //!< the number of clusters crossed
+                Time expire;            //!< the time the route becomes stale
+                uint32_t seq;           //!< the sequence number of the vector it was learnt from
+            };
+
+            /**
+             * the cluster of a node learnt
+             * from the distance vectors
+             */
+            struct ClusterMembership
+            {
+                Address clusterHead;    //!< the cluster head of the node
+                Time expire;            //!< the time the membership becomes stale
+            };
+
+            /**
+             * an entry of the routing table
+             */
+            struct RouteEntry
+            {
+                std::vector<RoutePath> paths;   //!< the next hops sorted by delay, the best first
+                MacKeySet precursors;   //!< the upstream neighbors forwarding through this node
+                Time installed;         //!< the time the route was installed or refreshed
+                Time lastUsed;          //!< the last time a packet used the route
+                EventId expire;         //!< the event of the expiracy of the route
+                EventId refresh;        //!< the event of the refresh before the expiracy
+                bool refreshing;        //!< a refresh discovery is running
+            };
+
             CognitiveRoutingUnite();              //!< the constructor
             ~CognitiveRoutingUnite() override;    //!< the destructor
 
@@ -83,6 +196,27 @@ typedef Callback<uint16_t> NumberOfNeighbors;
              */
             void SetDataRate(const DataRate dataRate);
 
+            /**
+             * @brief set the callback giving
+             * the MAC statistics of a link
+             * @param c the callback
+             */
+            void SetLinkStatsCallback(LinkStatsCallback c);
+
+            /**
+             * @brief set the number of route
+             * requests remembered to drop duplicates
+             * @param size the number of requests
+             */
+            void SetDuplicateCacheSize(uint32_t size);
+
+            /**
+             * @brief get the number of route
+             * requests remembered to drop duplicates
+             * @return the number of requests
+             */
+            uint32_t GetDuplicateCacheSize() const;
+
             /**
              * @brief Enable Routing
              * @param b true if routint
@@ -102,6 +236,24 @@ typedef Callback<uint16_t> NumberOfNeighbors;
              */
             static uint32_t NumReceivedPackets();
 
+            /**
+             * @return number of sent
+             * routing bytes
+             */
+            static uint32_t NumRoutingBytes();
+
+            /**
+             * @return number of received route
+             * requests already seen
+             */
+            static uint32_t NumDuplicateRequests();
+
+            /**
+             * @return number of route requests
+             * rebroadcast although already seen
+             */
+            static uint32_t NumDuplicateRebroadcasts();
+
             /**
              * @brief set the address 
              * of the node
@@ -148,6 +300,14 @@ typedef Callback<uint16_t> NumberOfNeighbors;
              */
             void SetNumberOfNeighboringNodesCallback(NumberOfNeighbors c);
 
+            /**
+             * @brief set the callback
+             * giving the members of the
+             * cluster of a cluster head
+             * @param c the callback
+             */
+            void SetClusterMembersCallback(ClusterMembersCallback c);
+
             /**
              * @brief start the route
              * discovery process
@@ -170,6 +330,37 @@ typedef Callback<uint16_t> NumberOfNeighbors;
              */
             void ReceiveRouteReply(Ptr<MacDcfFrame> frame);
             
+            /**
+             * @brief send the cluster distance
+             * vector of this cluster head
+             */
+            void SendClusterVector();
+
+            /**
+             * @brief receive a cluster distance
+             * vector from a cluster head or
+             * relayed by a gateway
+             * @param frame the message
+             */
+            void ReceiveClusterVector(Ptr<MacDcfFrame> frame);
+
+            /**
+             * @brief check if an advertised route to
+             * a cluster head replaces the known one,
+             * it must come from a newer vector of the
+             * head, or from the same vector with a
+             * lower delay
+             * @param routes the known routes
+             * @param head the cluster head
+             * @param seq the sequence number of the vector
+             * @param delay the advertised delay through the sender
+             * @return true if the route is taken
+             */
+            static bool IsBetterClusterRoute(const MacKeyMap<ClusterRoute>& routes,
+                                             Address head,
+                                             uint32_t seq,
+                                             double delay);
+
             /**
              * @brief end of the route
              * discovery process
@@ -179,9 +370,10 @@ typedef Callback<uint16_t> NumberOfNeighbors;
             
             /**
              * @brief send link outage msg
-             * @param frame the message
+             * @param des the unreachable destination
+             * @param address the neighbor to notify
              */
-            void SendRouteError(Address address);
+            void SendRouteError(Address des, Address address);
 
             /**
              * @brief receive broken link
@@ -190,12 +382,22 @@ typedef Callback<uint16_t> NumberOfNeighbors;
              */
             void ReceiveRouteError(Ptr<MacDcfFrame>frame);
 
+            /**
+             * @brief the MAC dropped a unicast
+             * frame, the link to its next hop
+             * is considered broken
+             * @param frame the dropped frame
+             */
+            void NotifyLinkFailure(Ptr<MacDcfFrame> frame);
+
             /**
              * @brief Calculate the link
              * delay between this node and
              * the next one
+             * @param nextHop the next node
+             * @return the delay in seconds
              */
-            double CalculateLinkDelay();
+            double CalculateLinkDelay(Address nextHop);
 
             /**
              * @brief set the node 
@@ -219,8 +421,9 @@ typedef Callback<uint16_t> NumberOfNeighbors;
              * @brief send the packets
              * to the destination after
              * finding the address
+             * @param des the destination
              */
-            void SendPendingPackets();
+            void SendPendingPackets(Address des);
 
             /**
              * @brief delete the 
@@ -229,6 +432,14 @@ typedef Callback<uint16_t> NumberOfNeighbors;
              * @param address of the node
              */
             void DeleteNode(Address address);
+
+            /**
+             * @brief remove a next hop from
+             * all the routes, the flows using it
+             * move to the remaining next hops
+             * @param nextHop the next hop
+             */
+            void DeleteNextHop(Address nextHop);
             
         protected:
             void DoDispose() override;
@@ -242,6 +453,77 @@ typedef Callback<uint16_t> NumberOfNeighbors;
              */
             void DeleteRequest(Address a ,Address b);
 
+            /**
+             * @brief find the next hop of a flow
+             * to a destination and mark the route used
+             * @param src the original sender of the flow
+             * @param des the destination
+             * @param nextHop the next hop if found
+             * @return true if there is a route
+             */
+            bool LookupRoute(Address src, Address des, Address& nextHop);
+
+            /**
+             * @brief choose one of the next hops
+             * of a route for a flow
+             * @param entry the route
+             * @param src the original sender of the flow
+             * @param des the destination
+             * @return the next hop
+             */
+            Address SelectPath(RouteEntry& entry, Address src, Address des);
+
+            /**
+             * @brief add or update the next hop
+             * of a route reply
+             * @param entry the route
+             * @param nextHop the sender of the reply
+             * @param delay the delay of the path
+             * @return true if the next hop is kept
+             */
+            bool AddPath(RouteEntry& entry, Address nextHop, double delay);
+
+            /**
+             * @brief start a background discovery
+             * for a route in use which is about
+             * to expire
+             * @param des the destination
+             */
+            void RefreshRoute(Address des);
+
+            /**
+             * @brief find the next hop to a
+             * destination from the cluster
+             * structure, without discovery
+             * @param des the destination
+             * @param nextHop the next hop if found
+             * @return true if the destination is known
+             */
+            bool ProactiveRoute(Address des, Address& nextHop);
+
+            /**
+             * @brief a route lost its last next hop,
+             * repair it locally or notify the precursors
+             * @param des the destination
+             */
+            void RouteLost(Address des);
+
+            /**
+             * @brief end of a local repair,
+             * notify the precursors if no route
+             * was found
+             * @param des the destination
+             */
+            void RepairTimeout(Address des);
+
+            /**
+             * @brief keep a packet until a
+             * route to its destination is found
+             * @param frame the frame of the packet
+             * @param des the destination
+             */
+            void EnqueuePending(Ptr<MacDcfFrame> frame, Address des);
+
             /**
              * @brief Get the info
              */
@@ -259,6 +541,9 @@ typedef Callback<uint16_t> NumberOfNeighbors;
             inline static uint32_t SentPackets = 0;     //!< number of packets created 
             inline static uint32_t RoutingBytes=0;      //!< number of received routing bytes
             inline static uint32_t ControlBytes=0;      //!< number of received control bytes
+            inline static uint32_t PendingDrops=0;      //!< number of packets dropped while waiting for a route
+            inline static uint32_t DuplicateRequests=0; //!< number of received route requests already seen
+            inline static uint32_t DuplicateRebroadcasts=0; //!< number of route requests rebroadcast although already seen
             const uint16_t routingProtocol = 989;       //!< the number of routing protocol
 
             DataRate m_dataRate;        //!< the data rate of the PHY
@@ -268,19 +553,50 @@ typedef Callback<uint16_t> NumberOfNeighbors;
             SendPacketCallback m_ctrlAppSendPacketCallback; //!< sending the packet to contorl app
             IsClusterMemberCallback m_IsClusterMemberCallback;  //!< used to know if the node is CM
             NumberOfNeighbors m_numberOfNeighborsCallback;    //!< the number of neighboring nodes
-
-            std::map<Address,Address> m_routingTable;       //!< the routing table and the total delay
-            std::map<Address,EventId> m_timers;             //!< the timers for the validity of addresses 
-            std::map<Address,double> m_minDelay;            //!< the minimum delay of the path
+            ClusterMembersCallback m_clusterMembersCallback;  //!< the members of the cluster of this head
+
+            MacKeyMap<RouteEntry> m_routingTable;           //!< the routing table
+            Time m_routeLifetime;                           //!< the validity of a route after its reply
+            Time m_refreshLead;                             //!< how long before the expiracy a used route is refreshed
+            uint32_t m_maxPaths;                            //!< the maximum number of next hops per destination
+            double m_pathStretch;                           //!< the worst delay of a next hop relative to the best one
+            MultipathPolicy m_multipathPolicy;              //!< the way flows are spread over the next hops
+            bool m_localRepair;                             //!< cluster heads and gateways repair broken routes
+            Time m_repairTimeout;                           //!< the time a local repair waits for a reply
+            MacKeyMap<MacKeySet> m_repairs;                 //!< the routes under repair and their precursors
+
+            bool m_proactive;                               //!< cluster heads exchange distance vectors
+            Time m_vectorPeriod;                            //!< the period of the cluster distance vectors
+            uint16_t m_maxClusterHops;                      //!< the farthest cluster kept from the vectors
+            uint32_t m_vectorSeq;                           //!< the sequence number of the last own vector
+            EventId m_vectorEvent;                          //!< the next own vector
+            CognitiveDuplicateCache m_vectorCache;          //!< the vectors seen by the node
+            MacKeyMap<ClusterRoute> m_clusterRoutes;        //!< the routes to the known cluster heads
+            MacKeyMap<ClusterMembership> m_clusterOf;       //!< the cluster head of the known nodes
             
             inline static std::map<uint32_t,Ptr<MacDcfFrame>> msgs; //!< the messages sent by routing layer 
 
 
-            std::vector<Ptr<MacDcfFrame>> *m_vector ;         //!< the vector of the routing unite
+            MacKeyMap<std::deque<std::pair<Time,
+                      Ptr<MacDcfFrame>>>> m_pending;           //!< the packets waiting for a route and their arrival time
+            uint32_t m_maxPending;                             //!< the maximum number of packets waiting for one destination
+            PendingDropPolicy m_pendingDropPolicy;             //!< the policy when the queue of a destination is full
+
+            TracedCallback<Ptr<const Packet>> m_pendingDropTrace;     //!< a packet waiting for a route was dropped
+            TracedCallback<Address,uint32_t> m_pendingDepthTrace;     //!< the depth of a pending queue changed
+            TracedCallback<Ptr<const Packet>,Time> m_discoveryDelayTrace; //!< a packet left its pending queue
+            TracedCallback<Ptr<const Packet>,Time> m_deliveredTrace;      //!< a packet reached its destination
+
+            LinkStatsCallback m_linkStatsCallback;  //!< the MAC statistics of a link
+            LinkDelayMetric m_linkDelayMetric;      //!< the delay used for a link
+
+            CognitiveDuplicateCache m_requestCache;            //!< the route requests seen by the node
+            uint32_t m_requestSeq;                             //!< the sequence number of the last own route request
+            bool m_suppressDuplicates;                         //!< true if an already seen request isn't rebroadcast
 
-            std::set<std::pair<Address,Address>> m_pendingReq; //!< set containing the pending route requests
+            MacKeyPairSet m_pendingReq;                        //!< set containing the pending route requests
             
-            std::set<Address> m_requiredAddresses;             //!< set containing the required addresses
+            MacKeySet m_requiredAddresses;                     //!< set containing the required addresses
 
             Time m_ExpiracyTime ;             //!< the expiracy date of the 
             inline static Time TotDelay =Seconds(0.0); //!< the total delay over all packets
@@ -15,7 +15,7 @@ NS_LOG_COMPONENT_DEFINE("MacDcfFrame");
 NS_OBJECT_ENSURE_REGISTERED(MacDcfFrame);
 
 MacDcfFrame::MacDcfFrame()
-    : m_packet(nullptr),m_totDelay(0.0)
+    : m_packet(nullptr),m_totDelay(0.0),m_reqSeq(0),m_clusterEpoch(0),m_dataChannel(0)
 {
 
 }
@@ -42,6 +42,7 @@ void
 MacDcfFrame::DoDispose()
 {
     m_packet=nullptr;
+    m_aggregate.clear();
     Object::DoDispose();
 }
 
@@ -171,6 +172,34 @@ MacDcfFrame::SetArrivalTime(const Time time)
     m_arrivalTime = time;
 }
 
+void
+
+MacDcfFrame::SetEnqueueTime(const Time time)
+{
+    m_enqueueTime = time;
+}
+
+Time
+
+MacDcfFrame::GetEnqueueTime()
+{
+    return m_enqueueTime;
+}
+
+void
+
+MacDcfFrame::SetClusterEpoch(uint32_t epoch)
+{
+    m_clusterEpoch = epoch;
+}
+
+uint32_t
+
+MacDcfFrame::GetClusterEpoch()
+{
+    return m_clusterEpoch;
+}
+
 void 
 
 MacDcfFrame::SetOriginalPacketUid(uint32_t uid)
@@ -234,4 +263,89 @@ MacDcfFrame::GetDelay()
     return m_totDelay;
 }
 
+void
+
+MacDcfFrame::SetRequestId(Mac48Address originator, uint32_t seq)
+{
+    m_reqOriginator = originator;
+    m_reqSeq = seq;
+}
+
+Mac48Address
+
+MacDcfFrame::GetRequestOriginator()
+{
+    return m_reqOriginator;
+}
+
+uint32_t
+
+MacDcfFrame::GetRequestSequence()
+{
+    return m_reqSeq;
+}
+
+void
+
+MacDcfFrame::SetAggregate(const std::vector<Ptr<MacDcfFrame>>& subframes)
+{
+    m_aggregate = subframes;
+}
+
+const std::vector<Ptr<MacDcfFrame>>&
+
+MacDcfFrame::GetAggregate()
+{
+    return m_aggregate;
+}
+
+bool
+
+MacDcfFrame::IsAggregate()
+{
+    return !m_aggregate.empty();
+}
+
+void
+
+MacDcfFrame::SetBlockAck(const std::vector<bool>& bitmap)
+{
+    m_blockAck = bitmap;
+}
+
+const std::vector<bool>&
+
+MacDcfFrame::GetBlockAck()
+{
+    return m_blockAck;
+}
+
+void
+
+MacDcfFrame::SetDataChannel(uint16_t channel)
+{
+    m_dataChannel = channel;
+}
+
+uint16_t
+
+MacDcfFrame::GetDataChannel()
+{
+    return m_dataChannel;
+}
+
+void
+
+MacDcfFrame::SetClusterVector(const std::vector<ClusterVectorEntry>& vector)
+{
+    m_clusterVector = vector;
+}
+
+const std::vector<ClusterVectorEntry>&
+
+MacDcfFrame::GetClusterVector()
+{
+    return m_clusterVector;
+}
+
 }
\ No newline at end of file
@@ -15,9 +15,24 @@
 #include <ns3/nstime.h>
 #include <ns3/data-rate.h>
 
+#include <vector>
+
 namespace ns3
 {
 
+/**
+ * a cluster advertised in a cluster
+ * distance vector message
+ */
+struct ClusterVectorEntry
+{
+    Address clusterHead;    //!< the cluster head of the cluster
+    double delay;           //!< the delay to reach the cluster head
+    uint16_t hops;          //!< the number of clusters crossed to reach it
+    uint32_t seq;           //!< the sequence number of the vector of the cluster head
+    std::vector<Address> members;   //!< the members of the cluster known to the sender
+};
+
 /**
  * this class is for the implementation of the DCF MAC protocl
  * it has four kinds of frams RTS,CTS,DATA,ACK
@@ -156,6 +171,34 @@ class MacDcfFrame : public Object
        */
       void SetArrivalTime(const Time  time);
 
+      /**
+       * Set the time the frame entered
+       * the MAC queue of the current hop
+       * @param time the time of the enqueue
+       */
+      void SetEnqueueTime(const Time time);
+
+      /**
+       * Get the time the frame entered
+       * the MAC queue of the current hop
+       * @return the time of the enqueue
+       */
+      Time GetEnqueueTime();
+
+      /**
+       * Set the cluster epoch of the current
+       * hop the frame was queued in
+       * @param epoch the epoch
+       */
+      void SetClusterEpoch(uint32_t epoch);
+
+      /**
+       * Get the cluster epoch of the current
+       * hop the frame was queued in
+       * @return the epoch
+       */
+      uint32_t GetClusterEpoch();
+
       /**
        * set the uid of the main packet 
        * @param uid 
@@ -197,6 +240,84 @@ class MacDcfFrame : public Object
        */
       double GetDelay();
 
+      /**
+       * set the identity of a route
+       * request, kept over the hops
+       * @param originator the node starting the discovery
+       * @param seq the sequence number of the originator
+       */
+      void SetRequestId(Mac48Address originator, uint32_t seq);
+
+      /**
+       * get the node starting
+       * the route discovery
+       */
+      Mac48Address GetRequestOriginator();
+
+      /**
+       * get the sequence number
+       * of the route request
+       */
+      uint32_t GetRequestSequence();
+
+      /**
+       * set the subframes carried
+       * by an aggregated frame
+       * @param subframes the subframes in transmission order
+       */
+      void SetAggregate(const std::vector<Ptr<MacDcfFrame>>& subframes);
+
+      /**
+       * get the subframes carried
+       * by an aggregated frame
+       */
+      const std::vector<Ptr<MacDcfFrame>>& GetAggregate();
+
+      /**
+       * @return true if the frame
+       * carries subframes
+       */
+      bool IsAggregate();
+
+      /**
+       * set the block ack bitmap of
+       * an aggregated frame
+       * @param bitmap true for every received subframe
+       */
+      void SetBlockAck(const std::vector<bool>& bitmap);
+
+      /**
+       * get the block ack bitmap
+       */
+      const std::vector<bool>& GetBlockAck();
+
+      /**
+       * set the channel of the data and
+       * the ack negotiated by an RTS or a CTS
+       * @param channel the channel index
+       */
+      void SetDataChannel(uint16_t channel);
+
+      /**
+       * get the channel of the data and
+       * the ack negotiated by an RTS or a CTS
+       * @return the channel index
+       */
+      uint16_t GetDataChannel();
+
+      /**
+       * set the clusters advertised
+       * by a cluster distance vector
+       * @param vector the clusters
+       */
+      void SetClusterVector(const std::vector<ClusterVectorEntry>& vector);
+
+      /**
+       * get the clusters advertised
+       * by a cluster distance vector
+       */
+      const std::vector<ClusterVectorEntry>& GetClusterVector();
+
       protected:
       void DoDispose() override;
       
@@ -207,14 +328,22 @@ class MacDcfFrame : public Object
       Mac48Address m_curTxAddress; //!< the address of the current sender hop
       Mac48Address m_curRxAddress; //!< the address of the current receiver hop
       Address m_requiredAddress;   //!< the required address 
+      Mac48Address m_reqOriginator;//!< the node starting the route discovery
       Time     m_duration;         //!< the duration of the transmission
       Time     m_creationTime ;    //!< the creation time of the packet
       Time     m_arrivalTime;      //!< the time for finishing reception
+      Time     m_enqueueTime;      //!< the time of entering the MAC queue of the current hop
       FrameType    m_kind;         //!< the kind of the frame
       RoutingMsgType m_rtType;     //!< the type of the routing message
       uint32_t m_originalPkt;      //!< the origial packet uid
       uint16_t m_protocolNum;      //!< the protocol number 
       double m_totDelay;           //!< the total delay(used for routing messages)
+      uint32_t m_reqSeq;           //!< the sequence number of the route request
+      uint32_t m_clusterEpoch;     //!< the cluster epoch of the current hop at the enqueue
+      std::vector<ClusterVectorEntry> m_clusterVector; //!< the advertised clusters (used for CDV messages)
+      std::vector<Ptr<MacDcfFrame>> m_aggregate;       //!< the subframes of an aggregated frame
+      std::vector<bool> m_blockAck;                    //!< the block ack bitmap (used for ACK frames)
+      uint16_t m_dataChannel;                          //!< the negotiated data channel (used for RTS and CTS frames)
 
 };
 
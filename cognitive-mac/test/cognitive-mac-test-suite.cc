@@ -1,9 +1,22 @@
 // Include a header file from your module to test.
 #include "ns3/cognitive-mac.h"
+#include "ns3/cognitive-channel-index.h"
+#include "ns3/cognitive-ncci-header.h"
+#include "ns3/cognitive-mac-key.h"
+#include "ns3/cognitive-duplicate-cache.h"
+#include "ns3/cognitive-mac-queue.h"
+#include "ns3/cognitive-control-application.h"
+#include "ns3/cognitive-general-net-device.h"
+#include "ns3/cognitive-routing-unite.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
 
+#include <vector>
+
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
 using namespace ns3;
@@ -56,6 +69,1633 @@ CognitiveMacTestCase1::DoRun()
     NS_TEST_ASSERT_MSG_EQ_TOL(0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+/**
+ * @ingroup cognitive-mac-tests
+ * Test the channel to neighbor count index in
+ * both dense and sparse storage
+ */
+class CognitiveChannelIndexTestCase : public TestCase
+{
+  public:
+    CognitiveChannelIndexTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+CognitiveChannelIndexTestCase::CognitiveChannelIndexTestCase()
+    : TestCase("Channel index counts neighbors and computes the channel fitness")
+{
+}
+
+void
+CognitiveChannelIndexTestCase::DoRun()
+{
+    std::map<uint16_t, double> quality = {{1, 0.5}, {2, 1.0}, {3, 0.25}, {2000, 2.0}};
+    MacKeyMap<std::pair<uint16_t, uint16_t>> clusters;
+    clusters[Mac48Address("00:00:00:00:00:09")] = std::make_pair(3, 1);
+
+    for (bool dense : {true, false})
+    {
+        CognitiveChannelIndex index;
+        index.SetDense(dense);
+        index.AddChannels({1, 2, 3, 2000});
+        index.AddChannels({2, 3});
+        index.AddChannels({2});
+        NS_TEST_ASSERT_MSG_EQ(index.GetCount(1), 1, "wrong count of channel 1");
+        NS_TEST_ASSERT_MSG_EQ(index.GetCount(2), 3, "wrong count of channel 2");
+        NS_TEST_ASSERT_MSG_EQ(index.GetCount(2000), 1, "wrong count of channel 2000");
+        NS_TEST_ASSERT_MSG_EQ(index.GetCount(7), 0, "unknown channel has neighbors");
+
+        // channel 3 is the CADC of a neighboring cluster so it is excluded
+        NS_TEST_ASSERT_MSG_EQ_TOL(index.ChannelFitness(quality, clusters),
+                                  0.5 * 1 + 1.0 * 3 + 2.0 * 1,
+                                  1e-9,
+                                  "wrong channel fitness");
+
+        index.RemoveChannels({2, 3});
+        index.SetDense(!dense);
+        NS_TEST_ASSERT_MSG_EQ(index.GetCount(2), 2, "count lost while changing the storage");
+        NS_TEST_ASSERT_MSG_EQ(index.GetCount(3), 1, "count lost while changing the storage");
+    }
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Test that full and delta NCCI headers survive
+ * the serialization and rebuild the sent tables
+ */
+class CognitiveNcciHeaderTestCase : public TestCase
+{
+  public:
+    CognitiveNcciHeaderTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Send a header through a packet and read it back
+     * @param header the header to send
+     * @return the received header
+     */
+    CognitiveNcciHeader Roundtrip(const CognitiveNcciHeader& header);
+};
+
+CognitiveNcciHeaderTestCase::CognitiveNcciHeaderTestCase()
+    : TestCase("NCCI header roundtrip of full and delta refreshes")
+{
+}
+
+CognitiveNcciHeader
+CognitiveNcciHeaderTestCase::Roundtrip(const CognitiveNcciHeader& header)
+{
+    Ptr<Packet> pkt = Create<Packet>();
+    pkt->AddHeader(header);
+    NS_TEST_EXPECT_MSG_EQ(pkt->GetSize(), header.GetSerializedSize(), "wrong packet size");
+    CognitiveNcciHeader received;
+    pkt->RemoveHeader(received);
+    return received;
+}
+
+void
+CognitiveNcciHeaderTestCase::DoRun()
+{
+    Address a = Mac48Address("00:00:00:00:00:01");
+    Address b = Mac48Address("00:00:00:00:00:02");
+    Address c = Mac48Address("00:00:00:00:00:03");
+
+    NcciTables base;
+    base.channelQuality = {{0, 0.5}, {3, 0.75}, {300, 0.125}};
+    base.neighborsInfo[a] = {0, 3};
+    base.neighborsInfo[b] = {3, 300};
+    base.channelIndex.AddChannels(base.neighborsInfo[a]);
+    base.channelIndex.AddChannels(base.neighborsInfo[b]);
+    base.neighborCluster[a] = std::make_pair(0, 3);
+
+    CognitiveNcciHeader full;
+    full.SetFull(base, 7, 120.5);
+    CognitiveNcciHeader receivedFull = Roundtrip(full);
+    NS_TEST_ASSERT_MSG_EQ(receivedFull.IsFull(), true, "full refresh read as delta");
+    NS_TEST_ASSERT_MSG_EQ(receivedFull.GetEpoch(), 7, "wrong epoch");
+    NS_TEST_ASSERT_MSG_EQ_TOL(receivedFull.GetEnergy(), 120.5, 1e-3, "wrong energy");
+
+    NcciTables rebuilt;
+    receivedFull.Apply(rebuilt);
+    NS_TEST_ASSERT_MSG_EQ((rebuilt.channelQuality == base.channelQuality), true, "wrong channels");
+    NS_TEST_ASSERT_MSG_EQ((rebuilt.neighborsInfo == base.neighborsInfo), true, "wrong neighbors");
+    NS_TEST_ASSERT_MSG_EQ((rebuilt.neighborCluster == base.neighborCluster), true, "wrong clusters");
+    NS_TEST_ASSERT_MSG_EQ(rebuilt.channelIndex.GetCount(3), 2, "wrong channel index");
+
+    NcciTables current = base;
+    current.channelQuality[3] = 0.25;
+    current.channelQuality.erase(300);
+    current.channelIndex.RemoveChannels(current.neighborsInfo[b]);
+    current.neighborsInfo.erase(b);
+    current.neighborsInfo[c] = {0};
+    current.channelIndex.AddChannels(current.neighborsInfo[c]);
+    current.neighborCluster[c] = std::make_pair(3, 0);
+
+    CognitiveNcciHeader delta;
+    delta.SetDelta(base, current, 7, 119);
+    NS_TEST_ASSERT_MSG_LT(delta.GetSerializedSize(), full.GetSerializedSize(), "delta isn't smaller");
+    CognitiveNcciHeader receivedDelta = Roundtrip(delta);
+    NS_TEST_ASSERT_MSG_EQ(receivedDelta.IsFull(), false, "delta read as full refresh");
+
+    receivedDelta.Apply(rebuilt);
+    NS_TEST_ASSERT_MSG_EQ((rebuilt.channelQuality == current.channelQuality), true, "wrong channels");
+    NS_TEST_ASSERT_MSG_EQ((rebuilt.neighborsInfo == current.neighborsInfo), true, "wrong neighbors");
+    NS_TEST_ASSERT_MSG_EQ((rebuilt.neighborCluster == current.neighborCluster), true, "wrong clusters");
+    NS_TEST_ASSERT_MSG_EQ(rebuilt.channelIndex.GetCount(0), 2, "wrong channel index");
+    NS_TEST_ASSERT_MSG_EQ(rebuilt.channelIndex.GetCount(300), 0, "wrong channel index");
+
+    // one neighbor whose address length overruns any Address
+    std::vector<uint8_t> oversized = {1, 7, 0, 0, 0, 1, 255};
+    oversized.resize(oversized.size() + 255, 0);
+    Ptr<Packet> bad = Create<Packet>(oversized.data(), oversized.size());
+    CognitiveNcciHeader receivedBad;
+    bad->RemoveHeader(receivedBad);
+    NS_TEST_ASSERT_MSG_EQ(receivedBad.IsValid(), false, "oversized address accepted");
+    NcciTables untouched = current;
+    receivedBad.Apply(untouched);
+    NS_TEST_ASSERT_MSG_EQ((untouched.neighborsInfo == current.neighborsInfo),
+                          true,
+                          "malformed header changed the tables");
+
+    Ptr<Packet> whole = Create<Packet>();
+    whole->AddHeader(full);
+    std::vector<uint8_t> bytes(whole->GetSize());
+    whole->CopyData(bytes.data(), bytes.size());
+    Ptr<Packet> truncated = Create<Packet>(bytes.data(), bytes.size() - 3);
+    CognitiveNcciHeader receivedTruncated;
+    truncated->RemoveHeader(receivedTruncated);
+    NS_TEST_ASSERT_MSG_EQ(receivedTruncated.IsValid(), false, "truncated header accepted");
+    NS_TEST_ASSERT_MSG_EQ(receivedFull.IsValid(), true, "valid header rejected");
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Test that the MAC keys give back their address
+ * and keep the order of the addresses
+ */
+class CognitiveMacKeyTestCase : public TestCase
+{
+  public:
+    CognitiveMacKeyTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+CognitiveMacKeyTestCase::CognitiveMacKeyTestCase()
+    : TestCase("MAC key conversion, order and hashed lookup")
+{
+}
+
+void
+CognitiveMacKeyTestCase::DoRun()
+{
+    Address a = Mac48Address("00:00:00:00:01:ff");
+    Address b = Mac48Address("00:00:00:00:02:00");
+    MacKey key(a);
+    NS_TEST_ASSERT_MSG_EQ(key.GetValue(), 0x1ff, "wrong packed value");
+    NS_TEST_ASSERT_MSG_EQ((key.GetAddress() == a), true, "the key doesn't give back the address");
+    NS_TEST_ASSERT_MSG_EQ((MacKey(a) < MacKey(b)), true, "the keys aren't ordered as the addresses");
+
+    MacKeyMap<double> values;
+    values[a] = 1.0;
+    values[b] = 2.0;
+    NS_TEST_ASSERT_MSG_EQ(values.count(Mac48Address("00:00:00:00:02:00")), 1, "lookup failed");
+    NS_TEST_ASSERT_MSG_EQ(values.count(Mac48Address("00:00:00:00:02:01")), 0, "unknown key found");
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Test that the duplicate cache detects a seen
+ * route request and forgets the oldest one
+ */
+class CognitiveDuplicateCacheTestCase : public TestCase
+{
+  public:
+    CognitiveDuplicateCacheTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+CognitiveDuplicateCacheTestCase::CognitiveDuplicateCacheTestCase()
+    : TestCase("Duplicate cache of the route requests")
+{
+}
+
+void
+CognitiveDuplicateCacheTestCase::DoRun()
+{
+    Address a = Mac48Address("00:00:00:00:00:01");
+    Address b = Mac48Address("00:00:00:00:00:02");
+    CognitiveDuplicateCache cache;
+    cache.SetCapacity(3);
+    NS_TEST_ASSERT_MSG_EQ(cache.Insert(a, 1), true, "a new request is a duplicate");
+    NS_TEST_ASSERT_MSG_EQ(cache.Insert(a, 1), false, "a seen request isn't a duplicate");
+    NS_TEST_ASSERT_MSG_EQ(cache.Insert(b, 1), true, "the originator is ignored");
+    NS_TEST_ASSERT_MSG_EQ(cache.Insert(a, 2), true, "the sequence number is ignored");
+    NS_TEST_ASSERT_MSG_EQ(cache.GetSize(), 3, "wrong size");
+
+    // the ring is full, the oldest request is forgotten first
+    NS_TEST_ASSERT_MSG_EQ(cache.Insert(b, 2), true, "a new request is a duplicate");
+    NS_TEST_ASSERT_MSG_EQ(cache.GetSize(), 3, "the cache grew over its capacity");
+    NS_TEST_ASSERT_MSG_EQ(cache.Contains(a, 1), false, "the oldest request wasn't evicted");
+    NS_TEST_ASSERT_MSG_EQ(cache.Contains(b, 1), true, "a recent request was evicted");
+    NS_TEST_ASSERT_MSG_EQ(cache.Insert(a, 1), true, "an evicted request is still a duplicate");
+    NS_TEST_ASSERT_MSG_EQ(cache.Contains(b, 1), false, "the eviction order is wrong");
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Priority lanes and drop policies of the MAC queue
+ */
+class CognitiveMacQueueTestCase : public TestCase
+{
+  public:
+    CognitiveMacQueueTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Create a frame of a protocol
+     * @param protocol the protocol number
+     * @return the frame
+     */
+    Ptr<MacDcfFrame> MakeFrame(uint16_t protocol);
+
+    /**
+     * Count the frames dropped by a queue
+     * @param packet the dropped packet
+     */
+    void Dropped(Ptr<const Packet> packet);
+
+    /**
+     * Look at the head of the queue and check the waiting frames
+     * @param queue the queue
+     * @param frames the expected number of frames
+     */
+    void CheckCoDel(Ptr<CognitiveMacQueue> queue, uint32_t frames);
+
+    uint32_t m_drops; //!< the dropped frames
+};
+
+CognitiveMacQueueTestCase::CognitiveMacQueueTestCase()
+    : TestCase("MAC queue priority lanes and drop policies"),
+      m_drops(0)
+{
+}
+
+Ptr<MacDcfFrame>
+CognitiveMacQueueTestCase::MakeFrame(uint16_t protocol)
+{
+    Ptr<MacDcfFrame> frame = CreateObject<MacDcfFrame>();
+    frame->SetPacket(Create<Packet>(100));
+    frame->SetProtocolNumber(protocol);
+    frame->SetEnqueueTime(Simulator::Now());
+    return frame;
+}
+
+void
+CognitiveMacQueueTestCase::Dropped(Ptr<const Packet> packet)
+{
+    m_drops++;
+}
+
+void
+CognitiveMacQueueTestCase::CheckCoDel(Ptr<CognitiveMacQueue> queue, uint32_t frames)
+{
+    queue->Peek();
+    NS_TEST_ASSERT_MSG_EQ(queue->GetNFrames(), frames, "CoDel dropped at the wrong time");
+}
+
+void
+CognitiveMacQueueTestCase::DoRun()
+{
+    Ptr<CognitiveMacQueue> queue = CreateObject<CognitiveMacQueue>();
+    queue->SetAttribute("MaxSize", UintegerValue(3));
+    queue->TraceConnectWithoutContext("Drop", MakeCallback(&CognitiveMacQueueTestCase::Dropped, this));
+
+    // the control and routing frames overtake the data frames
+    Ptr<MacDcfFrame> data1 = MakeFrame(1);
+    Ptr<MacDcfFrame> data2 = MakeFrame(1);
+    Ptr<MacDcfFrame> routing = MakeFrame(989);
+    NS_TEST_ASSERT_MSG_EQ(queue->Enqueue(data1), true, "a frame was refused below the capacity");
+    queue->Enqueue(data2);
+    queue->Enqueue(routing);
+    NS_TEST_ASSERT_MSG_EQ(queue->Peek(), routing, "the routing frame isn't served first");
+    NS_TEST_ASSERT_MSG_EQ(queue->Dequeue(), routing, "the routing frame isn't served first");
+    NS_TEST_ASSERT_MSG_EQ(queue->Dequeue(), data1, "the data frames aren't served in order");
+
+    // drop tail refuses the arriving data frame, a control frame takes the place of a data frame
+    Ptr<MacDcfFrame> data3 = MakeFrame(1);
+    queue->Enqueue(data3);
+    queue->Enqueue(MakeFrame(1));
+    NS_TEST_ASSERT_MSG_EQ(queue->Enqueue(MakeFrame(1)), false, "drop tail accepted a frame when full");
+    NS_TEST_ASSERT_MSG_EQ(m_drops, 1, "the drop wasn't traced");
+    Ptr<MacDcfFrame> control = MakeFrame(1000);
+    NS_TEST_ASSERT_MSG_EQ(queue->Enqueue(control), true, "a control frame was refused");
+    NS_TEST_ASSERT_MSG_EQ(queue->GetNFrames(), 3, "the queue grew over its capacity");
+    NS_TEST_ASSERT_MSG_EQ(queue->Dequeue(), control, "the control frame isn't served first");
+    NS_TEST_ASSERT_MSG_EQ(queue->Dequeue(), data3, "the oldest data frame wasn't displaced");
+
+    // head drop keeps the arriving frame
+    queue->SetAttribute("DropPolicy", EnumValue(CognitiveMacQueue::HEAD_DROP));
+    Ptr<MacDcfFrame> head = queue->Peek();
+    queue->Enqueue(MakeFrame(1));
+    queue->Enqueue(MakeFrame(1));
+    Ptr<MacDcfFrame> newest = MakeFrame(1);
+    NS_TEST_ASSERT_MSG_EQ(queue->Enqueue(newest), true, "head drop refused the arriving frame");
+    NS_TEST_ASSERT_MSG_NE(queue->Peek(), head, "head drop kept the oldest frame");
+    while (!queue->IsEmpty())
+    {
+        queue->Dequeue();
+    }
+
+    // CoDel drops once the sojourn stays above the target for an interval
+    queue->SetAttribute("DropPolicy", EnumValue(CognitiveMacQueue::CODEL));
+    queue->Enqueue(MakeFrame(1));
+    queue->Enqueue(MakeFrame(1));
+    Simulator::Schedule(MilliSeconds(10), &CognitiveMacQueueTestCase::CheckCoDel, this, queue, 2);
+    Simulator::Schedule(MilliSeconds(90), &CognitiveMacQueueTestCase::CheckCoDel, this, queue, 2);
+    Simulator::Schedule(MilliSeconds(120), &CognitiveMacQueueTestCase::CheckCoDel, this, queue, 1);
+    Simulator::Run();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Hysteresis and tenure of the cluster head choice
+ */
+class CognitiveClusterHysteresisTestCase : public TestCase
+{
+  public:
+    CognitiveClusterHysteresisTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+CognitiveClusterHysteresisTestCase::CognitiveClusterHysteresisTestCase()
+    : TestCase("Cluster head hysteresis margin and minimum tenure")
+{
+}
+
+void
+CognitiveClusterHysteresisTestCase::DoRun()
+{
+    Address head = Mac48Address("00:00:00:00:00:01");
+    Address gone = Mac48Address("00:00:00:00:00:05");
+    MacKeyMap<double> values;
+    values[head] = 0.5;
+    values[Mac48Address("00:00:00:00:00:02")] = 0.9;
+
+    // before the first choice there is nothing to keep
+    NS_TEST_ASSERT_MSG_EQ(CognitiveControlApplication::KeepCluster(values, Address(), 0.9, 0.05, true),
+                          false,
+                          "an invalid cluster head was kept");
+    NS_TEST_ASSERT_MSG_EQ(CognitiveControlApplication::KeepCluster(values, gone, 0.1, 0.05, true),
+                          false,
+                          "a cluster head that left was kept");
+
+    // after the tenure the best one must exceed the current one by the margin
+    NS_TEST_ASSERT_MSG_EQ(CognitiveControlApplication::KeepCluster(values, head, 0.53, 0.05, false),
+                          true,
+                          "switched for a gain below the margin");
+    NS_TEST_ASSERT_MSG_EQ(CognitiveControlApplication::KeepCluster(values, head, 0.6, 0.05, false),
+                          false,
+                          "kept the cluster head against a gain above the margin");
+    NS_TEST_ASSERT_MSG_EQ(CognitiveControlApplication::KeepCluster(values, head, 0.53, 0, false),
+                          false,
+                          "no margin still kept the worse cluster head");
+
+    // during the tenure the current one holds whatever the gain
+    NS_TEST_ASSERT_MSG_EQ(CognitiveControlApplication::KeepCluster(values, head, 0.9, 0.05, true),
+                          true,
+                          "switched during the tenure");
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Share of the full and delta NCCI refreshes
+ * with the default attributes
+ */
+class CognitiveNcciRefreshTestCase : public TestCase
+{
+  public:
+    CognitiveNcciRefreshTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+CognitiveNcciRefreshTestCase::CognitiveNcciRefreshTestCase()
+    : TestCase("NCCI full refresh interval with the default attributes")
+{
+}
+
+void
+CognitiveNcciRefreshTestCase::DoRun()
+{
+    Ptr<CognitiveControlApplication> app = CreateObject<CognitiveControlApplication>();
+    UintegerValue interval;
+    app->GetAttribute("NcciFullRefreshInterval", interval);
+
+    // the periodic NCCIs of 20 cluster ages, the first one has no base yet
+    uint32_t full = 0;
+    uint32_t delta = 0;
+    uint32_t sinceFull = 0;
+    bool haveBase = false;
+    for (uint32_t i = 0; i < 20; i++)
+    {
+        if (CognitiveControlApplication::IsFullNcci(false, haveBase, sinceFull, interval.Get()))
+        {
+            full++;
+            sinceFull = 0;
+            haveBase = true;
+        }
+        else
+        {
+            delta++;
+            sinceFull++;
+        }
+    }
+    NS_TEST_ASSERT_MSG_EQ(interval.Get(), 4, "wrong default interval");
+    NS_TEST_ASSERT_MSG_EQ(full, 4, "wrong number of full refreshes");
+    NS_TEST_ASSERT_MSG_EQ(delta, 16, "wrong number of deltas");
+
+    // a requested refresh and a zero interval always send the tables
+    NS_TEST_ASSERT_MSG_EQ(CognitiveControlApplication::IsFullNcci(true, true, 0, 4),
+                          true,
+                          "a requested full refresh was sent as a delta");
+    NS_TEST_ASSERT_MSG_EQ(CognitiveControlApplication::IsFullNcci(false, true, 0, 0),
+                          true,
+                          "a zero interval sent a delta");
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Retries, contention window and drops of the DCF
+ */
+class CognitiveDcfRetryTestCase : public TestCase
+{
+  public:
+    CognitiveDcfRetryTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Count the frames dropped by the device
+     * @param packet the dropped packet
+     */
+    void Dropped(Ptr<const Packet> packet);
+
+    uint32_t m_drops; //!< the dropped frames
+};
+
+CognitiveDcfRetryTestCase::CognitiveDcfRetryTestCase()
+    : TestCase("DCF retry limits, contention window doubling and drops"),
+      m_drops(0)
+{
+}
+
+void
+CognitiveDcfRetryTestCase::Dropped(Ptr<const Packet> packet)
+{
+    m_drops++;
+}
+
+void
+CognitiveDcfRetryTestCase::DoRun()
+{
+    Ptr<CognitiveGeneralNetDevice> device = CreateObject<CognitiveGeneralNetDevice>();
+    UintegerValue minCw;
+    UintegerValue maxCw;
+    UintegerValue shortLimit;
+    UintegerValue longLimit;
+    device->GetAttribute("MinCw", minCw);
+    device->GetAttribute("MaxCw", maxCw);
+    device->GetAttribute("ShortRetryLimit", shortLimit);
+    device->GetAttribute("LongRetryLimit", longLimit);
+
+    // every failed RTS doubles the window up to its maximum, the one over the limit drops
+    uint16_t max = maxCw.Get();
+    uint16_t cw = minCw.Get();
+    uint16_t expected = minCw.Get();
+    uint32_t retries = 0;
+    for (uint32_t i = 0; i < shortLimit.Get(); i++)
+    {
+        expected = std::min<uint32_t>(2 * expected + 1, max);
+        NS_TEST_ASSERT_MSG_EQ(CognitiveGeneralNetDevice::NextRetry(retries, shortLimit.Get(), cw, max),
+                              true,
+                              "dropped before the retry limit");
+        NS_TEST_ASSERT_MSG_EQ(cw, expected, "the contention window didn't double");
+    }
+    NS_TEST_ASSERT_MSG_EQ(retries, shortLimit.Get(), "a retry wasn't counted");
+    NS_TEST_ASSERT_MSG_EQ(cw, max, "the window didn't reach its maximum");
+    NS_TEST_ASSERT_MSG_EQ(CognitiveGeneralNetDevice::NextRetry(retries, shortLimit.Get(), cw, max),
+                          false,
+                          "retried over the limit");
+    NS_TEST_ASSERT_MSG_EQ(cw, max, "the window of a dropped frame changed");
+
+    // the data retries have their own, shorter limit
+    cw = minCw.Get();
+    retries = 0;
+    for (uint32_t i = 0; i < longLimit.Get(); i++)
+    {
+        CognitiveGeneralNetDevice::NextRetry(retries, longLimit.Get(), cw, max);
+    }
+    NS_TEST_ASSERT_MSG_EQ(cw,
+                          (minCw.Get() + 1) * (1 << longLimit.Get()) - 1,
+                          "the window is wrong after the data retries");
+    NS_TEST_ASSERT_MSG_EQ(CognitiveGeneralNetDevice::NextRetry(retries, longLimit.Get(), cw, max),
+                          false,
+                          "retried the data over the limit");
+
+    // without a limit the first failure drops
+    retries = 0;
+    NS_TEST_ASSERT_MSG_EQ(CognitiveGeneralNetDevice::NextRetry(retries, 0, cw, max),
+                          false,
+                          "retried with a zero limit");
+
+    // a late timeout without a frame in service neither retries nor drops
+    device->TraceConnectWithoutContext("MacTxDrop",
+                                       MakeCallback(&CognitiveDcfRetryTestCase::Dropped, this));
+    device->AckTimeout();
+    device->CtsTimeout();
+    device->DropPacket();
+    NS_TEST_ASSERT_MSG_EQ(m_drops, 0, "a frame was dropped while none is in service");
+
+    device->Dispose();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Sequence numbers of the cluster distance vectors
+ */
+class CognitiveClusterVectorTestCase : public TestCase
+{
+  public:
+    CognitiveClusterVectorTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+CognitiveClusterVectorTestCase::CognitiveClusterVectorTestCase()
+    : TestCase("Cluster distance vector sequence numbers")
+{
+}
+
+void
+CognitiveClusterVectorTestCase::DoRun()
+{
+    using ClusterRoute = CognitiveRoutingUnite::ClusterRoute;
+    Address head = Mac48Address("00:00:00:00:00:01");
+    Address neighbor = Mac48Address("00:00:00:00:00:02");
+    MacKeyMap<ClusterRoute> routes;
+
+    NS_TEST_ASSERT_MSG_EQ(CognitiveRoutingUnite::IsBetterClusterRoute(routes, head, 1, 5.0),
+                          true,
+                          "the first route to a cluster head was refused");
+    routes[head] = ClusterRoute{neighbor, 5.0, 1, Seconds(10), 5};
+
+    // the same vector is only taken through a lower delay
+    NS_TEST_ASSERT_MSG_EQ(CognitiveRoutingUnite::IsBetterClusterRoute(routes, head, 5, 4.0),
+                          true,
+                          "a lower delay of the same vector was refused");
+    NS_TEST_ASSERT_MSG_EQ(CognitiveRoutingUnite::IsBetterClusterRoute(routes, head, 5, 7.0),
+                          false,
+                          "a higher delay of the same vector replaced the route");
+
+    // the route echoed back after the head was lost counts to infinity without the sequence
+    NS_TEST_ASSERT_MSG_EQ(CognitiveRoutingUnite::IsBetterClusterRoute(routes, head, 4, 1.0),
+                          false,
+                          "an older vector replaced the route");
+
+    // a newer vector wins whatever its delay, also across the wrap of the sequence
+    NS_TEST_ASSERT_MSG_EQ(CognitiveRoutingUnite::IsBetterClusterRoute(routes, head, 6, 50.0),
+                          true,
+                          "a newer vector was refused");
+    routes[head].seq = 0xffffffff;
+    NS_TEST_ASSERT_MSG_EQ(CognitiveRoutingUnite::IsBetterClusterRoute(routes, head, 0, 50.0),
+                          true,
+                          "the vector after the wrap of the sequence was refused");
+
+    // a stale route is only refreshed by a newer vector
+    routes[head] = ClusterRoute{neighbor, 5.0, 1, Seconds(0), 5};
+    NS_TEST_ASSERT_MSG_EQ(CognitiveRoutingUnite::IsBetterClusterRoute(routes, head, 5, 1.0),
+                          false,
+                          "the vector of a stale route was taken again");
+    NS_TEST_ASSERT_MSG_EQ(CognitiveRoutingUnite::IsBetterClusterRoute(routes, head, 6, 9.0),
+                          true,
+                          "a newer vector didn't refresh a stale route");
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * A routing unit without devices, the frames it sends are kept
+ */
+class CognitiveRoutingTestCase : public TestCase
+{
+  protected:
+    /**
+     * Constructor
+     * @param name the name of the test case
+     */
+    CognitiveRoutingTestCase(std::string name);
+
+    /**
+     * Create a routing unit sending through the test case
+     * @param address the address of the node
+     * @return the routing unit
+     */
+    Ptr<CognitiveRoutingUnite> CreateRoutingUnite(Address address);
+
+    /**
+     * Create a route reply coming from a neighbor
+     * @param des the destination of the route
+     * @param sender the neighbor
+     * @param delay the delay from the neighbor to the destination
+     * @return the reply
+     */
+    Ptr<MacDcfFrame> MakeReply(Address des, Address sender, double delay);
+
+    /**
+     * Keep a frame sent by the data device
+     * @param frame the frame
+     */
+    void SendData(Ptr<MacDcfFrame> frame);
+
+    /**
+     * Keep a frame sent by the control device
+     * @param frame the frame
+     */
+    void SendCtrl(Ptr<MacDcfFrame> frame);
+
+    /**
+     * Measured statistics of every link, one sample without delay
+     * @param neighbor the neighbor
+     * @return the statistics
+     */
+    LinkStats GetLinkStats(Address neighbor);
+
+    std::vector<Ptr<MacDcfFrame>> m_dataFrames; //!< the frames sent by the data device
+    std::vector<Ptr<MacDcfFrame>> m_ctrlFrames; //!< the frames sent by the control device
+};
+
+CognitiveRoutingTestCase::CognitiveRoutingTestCase(std::string name)
+    : TestCase(name)
+{
+}
+
+Ptr<CognitiveRoutingUnite>
+CognitiveRoutingTestCase::CreateRoutingUnite(Address address)
+{
+    Ptr<CognitiveRoutingUnite> unite = CreateObject<CognitiveRoutingUnite>();
+    unite->SetAddress(address);
+    unite->SetCluster(address);
+    unite->SetDataRate(DataRate("6Mbps"));
+    unite->EnableRouting(true);
+    unite->SetSendDataFrameCallback(MakeCallback(&CognitiveRoutingTestCase::SendData, this));
+    unite->SetSendCtrlFrameCallback(MakeCallback(&CognitiveRoutingTestCase::SendCtrl, this));
+    unite->SetLinkStatsCallback(MakeCallback(&CognitiveRoutingTestCase::GetLinkStats, this));
+    return unite;
+}
+
+Ptr<MacDcfFrame>
+CognitiveRoutingTestCase::MakeReply(Address des, Address sender, double delay)
+{
+    Ptr<MacDcfFrame> reply = CreateObject<MacDcfFrame>();
+    reply->SetPacket(Create<Packet>(RRepSize));
+    reply->SetMsgType(RoutingMsgType::RRep);
+    reply->SetRequiredAddress(des);
+    reply->SetCurrentSender(Mac48Address::ConvertFrom(sender));
+    reply->SetDelay(delay);
+    return reply;
+}
+
+void
+CognitiveRoutingTestCase::SendData(Ptr<MacDcfFrame> frame)
+{
+    m_dataFrames.push_back(frame);
+}
+
+void
+CognitiveRoutingTestCase::SendCtrl(Ptr<MacDcfFrame> frame)
+{
+    m_ctrlFrames.push_back(frame);
+}
+
+LinkStats
+CognitiveRoutingTestCase::GetLinkStats(Address neighbor)
+{
+    LinkStats stats;
+    stats.samples = 1;
+    return stats;
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Per-destination queues of the packets waiting for a route
+ */
+class CognitivePendingQueueTestCase : public CognitiveRoutingTestCase
+{
+  public:
+    CognitivePendingQueueTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Keep a packet dropped from a pending queue
+     * @param packet the packet
+     */
+    void Dropped(Ptr<const Packet> packet);
+
+    /**
+     * Count the packets leaving a pending queue
+     * @param packet the packet
+     * @param delay the time it waited
+     */
+    void Released(Ptr<const Packet> packet, Time delay);
+
+    std::vector<uint32_t> m_dropped; //!< the uids of the dropped packets
+    uint32_t m_released;             //!< the packets sent after the discovery
+};
+
+CognitivePendingQueueTestCase::CognitivePendingQueueTestCase()
+    : CognitiveRoutingTestCase("Pending queues and their drop policies"),
+      m_released(0)
+{
+}
+
+void
+CognitivePendingQueueTestCase::Dropped(Ptr<const Packet> packet)
+{
+    m_dropped.push_back(packet->GetUid());
+}
+
+void
+CognitivePendingQueueTestCase::Released(Ptr<const Packet> packet, Time delay)
+{
+    m_released++;
+}
+
+void
+CognitivePendingQueueTestCase::DoRun()
+{
+    Address node = Mac48Address("00:00:00:00:00:01");
+    Address neighbor = Mac48Address("00:00:00:00:00:02");
+    Address first = Mac48Address("00:00:00:00:00:0a");
+    Address second = Mac48Address("00:00:00:00:00:0b");
+    Ptr<CognitiveRoutingUnite> unite = CreateRoutingUnite(node);
+    unite->SetAttribute("MaxPendingPackets", UintegerValue(2));
+    unite->TraceConnectWithoutContext("PendingDrop",
+                                      MakeCallback(&CognitivePendingQueueTestCase::Dropped, this));
+    unite->TraceConnectWithoutContext("DiscoveryDelay",
+                                      MakeCallback(&CognitivePendingQueueTestCase::Released, this));
+
+    // drop newest refuses the packet arriving at a full queue
+    std::vector<Ptr<Packet>> packets;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        packets.push_back(Create<Packet>(100));
+        unite->SendPacket(packets.back(), node, first, 1);
+    }
+    NS_TEST_ASSERT_MSG_EQ(m_dataFrames.size(), 0, "a packet without a route was sent");
+    NS_TEST_ASSERT_MSG_EQ(m_dropped.size(), 1, "the full queue didn't drop");
+    NS_TEST_ASSERT_MSG_EQ(m_dropped[0],
+                          packets[2]->GetUid(),
+                          "drop newest dropped a queued packet");
+
+    // every destination has its own queue, drop oldest makes room for the arriving packet
+    Ptr<Packet> oldest = Create<Packet>(100);
+    unite->SendPacket(oldest, node, second, 1);
+    NS_TEST_ASSERT_MSG_EQ(m_dropped.size(), 1, "the queue of another destination dropped");
+    unite->SetAttribute("PendingDropPolicy", EnumValue(CognitiveRoutingUnite::DROP_OLDEST));
+    unite->SendPacket(Create<Packet>(100), node, second, 1);
+    unite->SendPacket(Create<Packet>(100), node, second, 1);
+    NS_TEST_ASSERT_MSG_EQ(m_dropped.size(), 2, "the full queue didn't drop");
+    NS_TEST_ASSERT_MSG_EQ(m_dropped[1], oldest->GetUid(), "drop oldest didn't drop the oldest");
+
+    // the reply releases the queue of its destination only, in the arrival order
+    unite->ReceiveRouteReply(MakeReply(first, neighbor, 0.01));
+    NS_TEST_ASSERT_MSG_EQ(m_released, 2, "the waiting packets weren't released");
+    NS_TEST_ASSERT_MSG_EQ(m_dataFrames.size(), 2, "the wrong packets were sent");
+    NS_TEST_ASSERT_MSG_EQ(m_dataFrames[0]->GetPacket(), packets[0], "the packets were reordered");
+    NS_TEST_ASSERT_MSG_EQ(m_dataFrames[1]->GetPacket(), packets[1], "the packets were reordered");
+    NS_TEST_ASSERT_MSG_EQ(Address(m_dataFrames[0]->GetCurrentReceiver()),
+                          neighbor,
+                          "the packet didn't go to the next hop");
+
+    unite->Dispose();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Background refresh of the routes in use before they expire
+ */
+class CognitiveRouteRefreshTestCase : public CognitiveRoutingTestCase
+{
+  public:
+    CognitiveRouteRefreshTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Check the number of route requests sent for a destination
+     * @param des the destination
+     * @param requests the expected number of requests
+     */
+    void CheckRequests(Address des, uint32_t requests);
+};
+
+CognitiveRouteRefreshTestCase::CognitiveRouteRefreshTestCase()
+    : CognitiveRoutingTestCase("Refresh of the routes in use before their expiry")
+{
+}
+
+void
+CognitiveRouteRefreshTestCase::CheckRequests(Address des, uint32_t requests)
+{
+    uint32_t sent = 0;
+    for (auto& frame : m_ctrlFrames)
+    {
+        if (frame->GetMsgType() == RoutingMsgType::RReq && frame->GetRequiredAddress() == des)
+        {
+            sent++;
+        }
+    }
+    NS_TEST_ASSERT_MSG_EQ(sent, requests, "wrong number of route requests at " << Simulator::Now());
+}
+
+void
+CognitiveRouteRefreshTestCase::DoRun()
+{
+    Address node = Mac48Address("00:00:00:00:00:01");
+    Address neighbor = Mac48Address("00:00:00:00:00:02");
+    Address other = Mac48Address("00:00:00:00:00:03");
+    Address used = Mac48Address("00:00:00:00:00:0a");
+    Address idle = Mac48Address("00:00:00:00:00:0b");
+    Ptr<CognitiveRoutingUnite> unite = CreateRoutingUnite(node);
+    unite->SetAttribute("RouteLifetime", TimeValue(Seconds(2.5)));
+    unite->SetAttribute("RouteRefreshLead", TimeValue(Seconds(0.5)));
+
+    unite->ReceiveRouteReply(MakeReply(used, neighbor, 0.01));
+    unite->ReceiveRouteReply(MakeReply(idle, neighbor, 0.01));
+    Simulator::Schedule(Seconds(1),
+                        &CognitiveRoutingUnite::SendPacket,
+                        unite,
+                        Create<Packet>(100),
+                        node,
+                        used,
+                        1);
+
+    // only the route used since its reply is rediscovered, before it expires
+    Simulator::Schedule(Seconds(1.9), &CognitiveRouteRefreshTestCase::CheckRequests, this, used, 0);
+    Simulator::Schedule(Seconds(2.1), &CognitiveRouteRefreshTestCase::CheckRequests, this, used, 1);
+    Simulator::Schedule(Seconds(2.1), &CognitiveRouteRefreshTestCase::CheckRequests, this, idle, 0);
+
+    // the first reply of the refresh replaces the next hop and renews the route
+    Simulator::Schedule(Seconds(2.2),
+                        &CognitiveRoutingUnite::ReceiveRouteReply,
+                        unite,
+                        MakeReply(used, other, 0.01));
+    Simulator::Schedule(Seconds(3),
+                        &CognitiveRoutingUnite::SendPacket,
+                        unite,
+                        Create<Packet>(100),
+                        node,
+                        used,
+                        1);
+
+    // the idle route expired, its packet waits for a new discovery
+    Simulator::Schedule(Seconds(3),
+                        &CognitiveRoutingUnite::SendPacket,
+                        unite,
+                        Create<Packet>(100),
+                        node,
+                        idle,
+                        1);
+    Simulator::Schedule(Seconds(3.1), &CognitiveRouteRefreshTestCase::CheckRequests, this, idle, 1);
+    Simulator::Stop(Seconds(4));
+    Simulator::Run();
+
+    NS_TEST_ASSERT_MSG_EQ(m_dataFrames.size(), 2, "the packet of the expired route was sent");
+    NS_TEST_ASSERT_MSG_EQ(Address(m_dataFrames[0]->GetCurrentReceiver()),
+                          neighbor,
+                          "the packet didn't use the route");
+    NS_TEST_ASSERT_MSG_EQ(Address(m_dataFrames[1]->GetCurrentReceiver()),
+                          other,
+                          "the refresh didn't replace the next hop");
+
+    unite->Dispose();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Link delay measured by the MAC and its analytical fallback
+ */
+class CognitiveLinkDelayTestCase : public CognitiveRoutingTestCase
+{
+  public:
+    CognitiveLinkDelayTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Statistics of the links, only the measured neighbor has samples
+     * @param neighbor the neighbor
+     * @return the statistics
+     */
+    LinkStats GetMeasuredStats(Address neighbor);
+
+    /**
+     * @return the number of neighbors of the node
+     */
+    uint16_t GetNeighbors();
+
+    Address m_measured;   //!< the neighbor with samples
+    uint16_t m_neighbors; //!< the number of neighbors
+};
+
+CognitiveLinkDelayTestCase::CognitiveLinkDelayTestCase()
+    : CognitiveRoutingTestCase("Measured link delay and its analytical fallback"),
+      m_measured(Mac48Address("00:00:00:00:00:02")),
+      m_neighbors(4)
+{
+}
+
+LinkStats
+CognitiveLinkDelayTestCase::GetMeasuredStats(Address neighbor)
+{
+    LinkStats stats;
+    if (neighbor == m_measured)
+    {
+        stats.queueDelay = 0.002;
+        stats.serviceTime = 0.003;
+        stats.samples = 10;
+    }
+    return stats;
+}
+
+uint16_t
+CognitiveLinkDelayTestCase::GetNeighbors()
+{
+    return m_neighbors;
+}
+
+void
+CognitiveLinkDelayTestCase::DoRun()
+{
+    Address unknown = Mac48Address("00:00:00:00:00:03");
+    Ptr<CognitiveRoutingUnite> unite = CreateRoutingUnite(Mac48Address("00:00:00:00:00:01"));
+    unite->SetLinkStatsCallback(MakeCallback(&CognitiveLinkDelayTestCase::GetMeasuredStats, this));
+    unite->SetNumberOfNeighboringNodesCallback(
+        MakeCallback(&CognitiveLinkDelayTestCase::GetNeighbors, this));
+
+    // the switching delay plus the measured queue delay and service time
+    NS_TEST_ASSERT_MSG_EQ_TOL(unite->CalculateLinkDelay(m_measured),
+                              0.011,
+                              1e-9,
+                              "the measured delay wasn't used");
+
+    // a link without samples falls back to the model
+    double model = unite->CalculateLinkDelay(unknown);
+    unite->SetAttribute("LinkDelayMetric", EnumValue(CognitiveRoutingUnite::ANALYTICAL_DELAY));
+    NS_TEST_ASSERT_MSG_EQ_TOL(unite->CalculateLinkDelay(unknown),
+                              model,
+                              1e-12,
+                              "a link without samples didn't use the model");
+    NS_TEST_ASSERT_MSG_EQ_TOL(unite->CalculateLinkDelay(m_measured),
+                              model,
+                              1e-12,
+                              "the analytical metric used the measurement");
+    NS_TEST_ASSERT_MSG_GT(model, 0.006, "the model has no queue and backoff delay");
+
+    // the model grows with the contention
+    m_neighbors = 8;
+    NS_TEST_ASSERT_MSG_GT(unite->CalculateLinkDelay(unknown),
+                          model,
+                          "more neighbors didn't increase the delay");
+
+    unite->Dispose();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Next hops of a multipath route and the spreading of the flows
+ */
+class CognitiveMultipathTestCase : public CognitiveRoutingTestCase
+{
+  public:
+    CognitiveMultipathTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Send a packet of a flow and get its next hop
+     * @param unite the routing unit
+     * @param src the source of the flow
+     * @param des the destination of the flow
+     * @return the next hop
+     */
+    Address Forward(Ptr<CognitiveRoutingUnite> unite, Address src, Address des);
+};
+
+CognitiveMultipathTestCase::CognitiveMultipathTestCase()
+    : CognitiveRoutingTestCase("Multipath delay stretch, path limit and flow stickiness")
+{
+}
+
+Address
+CognitiveMultipathTestCase::Forward(Ptr<CognitiveRoutingUnite> unite, Address src, Address des)
+{
+    unite->SendPacket(Create<Packet>(100), src, des, 1);
+    return m_dataFrames.back()->GetCurrentReceiver();
+}
+
+void
+CognitiveMultipathTestCase::DoRun()
+{
+    Address node = Mac48Address("00:00:00:00:00:01");
+    Address des = Mac48Address("00:00:00:00:00:0a");
+    Address first = Mac48Address("00:00:00:00:00:02");
+    Address second = Mac48Address("00:00:00:00:00:03");
+    Address slow = Mac48Address("00:00:00:00:00:04");
+    Address best = Mac48Address("00:00:00:00:00:05");
+    Address late = Mac48Address("00:00:00:00:00:06");
+    Ptr<CognitiveRoutingUnite> unite = CreateRoutingUnite(node);
+    unite->SetAttribute("MaxPaths", UintegerValue(3));
+    unite->SetAttribute("PathDelayStretch", DoubleValue(1.5));
+
+    // every link adds 6 ms, a next hop over 1.5 times the best delay is refused
+    unite->ReceiveRouteReply(MakeReply(des, first, 0.010));
+    unite->ReceiveRouteReply(MakeReply(des, second, 0.012));
+    unite->ReceiveRouteReply(MakeReply(des, slow, 0.050));
+    unite->ReceiveRouteReply(MakeReply(des, best, 0.008));
+
+    // a flow sticks to its next hop
+    std::vector<Address> sources;
+    std::vector<Address> hops;
+    for (uint32_t i = 0; i < 24; i++)
+    {
+        sources.push_back(Mac48Address::Allocate());
+        hops.push_back(Forward(unite, sources[i], des));
+        NS_TEST_ASSERT_MSG_NE(hops[i], slow, "a next hop over the stretch was used");
+        NS_TEST_ASSERT_MSG_EQ(Forward(unite, sources[i], des),
+                              hops[i],
+                              "a flow changed its next hop");
+    }
+
+    // losing a next hop moves only the flows it carried
+    unite->DeleteNextHop(second);
+    for (uint32_t i = 0; i < sources.size(); i++)
+    {
+        Address hop = Forward(unite, sources[i], des);
+        NS_TEST_ASSERT_MSG_NE(hop, second, "a flow still uses the lost next hop");
+        if (hops[i] != second)
+        {
+            NS_TEST_ASSERT_MSG_EQ(hop, hops[i], "a flow moved from a next hop still in use");
+        }
+        hops[i] = hop;
+    }
+
+    // a full route replaces its worst next hop by a better one only
+    unite->SetAttribute("MaxPaths", UintegerValue(2));
+    unite->ReceiveRouteReply(MakeReply(des, slow, 0.011));
+    unite->ReceiveRouteReply(MakeReply(des, late, 0.009));
+    for (uint32_t i = 0; i < sources.size(); i++)
+    {
+        Address hop = Forward(unite, sources[i], des);
+        NS_TEST_ASSERT_MSG_EQ((hop == best || hop == late), true, "the worst next hop was kept");
+        if (hops[i] == best)
+        {
+            NS_TEST_ASSERT_MSG_EQ(hop, best, "a flow moved from a next hop still in use");
+        }
+    }
+
+    // the weighted round robin spreads one flow by the inverse delay
+    unite->SetAttribute("MultipathPolicy", EnumValue(CognitiveRoutingUnite::WEIGHTED_ROUND_ROBIN));
+    uint32_t onBest = 0;
+    uint32_t onLate = 0;
+    for (uint32_t i = 0; i < 30; i++)
+    {
+        Address hop = Forward(unite, sources[0], des);
+        onBest += hop == best;
+        onLate += hop == late;
+    }
+    NS_TEST_ASSERT_MSG_EQ(onBest + onLate, 30, "a packet used a removed next hop");
+    NS_TEST_ASSERT_MSG_GT(onLate, 0, "the round robin didn't use the second next hop");
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(onBest, onLate, "the faster next hop got fewer packets");
+
+    unite->Dispose();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Route errors and the local repair of the lost routes
+ */
+class CognitiveLocalRepairTestCase : public CognitiveRoutingTestCase
+{
+  public:
+    CognitiveLocalRepairTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Create a data frame on one of its hops
+     * @param des the destination
+     * @param sender the sender of the hop
+     * @param receiver the receiver of the hop
+     * @return the frame
+     */
+    Ptr<MacDcfFrame> MakeData(Address des, Address sender, Address receiver);
+
+    /**
+     * Check the route errors sent to the precursor
+     * @param des the destination of the expected error, invalid if none is expected
+     */
+    void CheckErrors(Address des);
+
+    /**
+     * Count the packets dropped at the end of a repair
+     * @param packet the packet
+     */
+    void Dropped(Ptr<const Packet> packet);
+
+    Address m_source;    //!< the source of the flows
+    Address m_precursor; //!< the upstream hop of the flows
+    uint32_t m_drops;    //!< the dropped packets
+};
+
+CognitiveLocalRepairTestCase::CognitiveLocalRepairTestCase()
+    : CognitiveRoutingTestCase("Route errors and local repair"),
+      m_source(Mac48Address("00:00:00:00:00:20")),
+      m_precursor(Mac48Address("00:00:00:00:00:21")),
+      m_drops(0)
+{
+}
+
+Ptr<MacDcfFrame>
+CognitiveLocalRepairTestCase::MakeData(Address des, Address sender, Address receiver)
+{
+    Ptr<MacDcfFrame> frame = CreateObject<MacDcfFrame>();
+    frame->SetPacket(Create<Packet>(100));
+    frame->SetProtocolNumber(1);
+    frame->SetOriginalSender(Mac48Address::ConvertFrom(m_source));
+    frame->SetOriginalReceiver(Mac48Address::ConvertFrom(des));
+    frame->SetCurrentSender(Mac48Address::ConvertFrom(sender));
+    frame->SetCurrentReceiver(Mac48Address::ConvertFrom(receiver));
+    frame->SetCreationTime(Simulator::Now());
+    return frame;
+}
+
+void
+CognitiveLocalRepairTestCase::CheckErrors(Address des)
+{
+    std::vector<Ptr<MacDcfFrame>> errors;
+    for (auto& frame : m_ctrlFrames)
+    {
+        if (frame->GetMsgType() == RoutingMsgType::RErr)
+        {
+            errors.push_back(frame);
+        }
+    }
+    NS_TEST_ASSERT_MSG_EQ(errors.size(),
+                          des.IsInvalid() ? 0 : 1,
+                          "wrong number of route errors at " << Simulator::Now());
+    if (!errors.empty())
+    {
+        NS_TEST_ASSERT_MSG_EQ(errors[0]->GetRequiredAddress(),
+                              des,
+                              "the error names the wrong route");
+        NS_TEST_ASSERT_MSG_EQ(Address(errors[0]->GetCurrentReceiver()),
+                              m_precursor,
+                              "the error didn't go to the precursor");
+    }
+}
+
+void
+CognitiveLocalRepairTestCase::Dropped(Ptr<const Packet> packet)
+{
+    m_drops++;
+}
+
+void
+CognitiveLocalRepairTestCase::DoRun()
+{
+    Address node = Mac48Address("00:00:00:00:00:01");
+    Address broken = Mac48Address("00:00:00:00:00:02");
+    Address alternative = Mac48Address("00:00:00:00:00:03");
+    Address repaired = Mac48Address("00:00:00:00:00:0a");
+    Address lost = Mac48Address("00:00:00:00:00:0b");
+
+    // a member doesn't repair, the precursor hears of the broken route at once
+    Ptr<CognitiveRoutingUnite> member = CreateRoutingUnite(node);
+    member->ReceiveRouteReply(MakeReply(lost, broken, 0.01));
+    member->ReceiveFrame(MakeData(lost, m_precursor, node));
+    Ptr<MacDcfFrame> error = CreateObject<MacDcfFrame>();
+    error->SetPacket(Create<Packet>(RErrSize));
+    error->SetMsgType(RoutingMsgType::RErr);
+    error->SetRequiredAddress(lost);
+    error->SetCurrentSender(Mac48Address::ConvertFrom(broken));
+    member->ReceiveRouteError(error);
+    CheckErrors(lost);
+    member->Dispose();
+    m_ctrlFrames.clear();
+    m_dataFrames.clear();
+
+    // a cluster head rediscovers the routes lost with a next hop before reporting them
+    Ptr<CognitiveRoutingUnite> head = CreateRoutingUnite(node);
+    head->SetClusterHeadStatus(true);
+    head->SetAttribute("RepairTimeout", TimeValue(Seconds(0.5)));
+    head->TraceConnectWithoutContext("PendingDrop",
+                                     MakeCallback(&CognitiveLocalRepairTestCase::Dropped, this));
+    head->ReceiveRouteReply(MakeReply(repaired, broken, 0.01));
+    head->ReceiveRouteReply(MakeReply(lost, broken, 0.01));
+    head->ReceiveFrame(MakeData(repaired, m_precursor, node));
+    head->ReceiveFrame(MakeData(lost, m_precursor, node));
+    head->NotifyLinkFailure(MakeData(repaired, node, broken));
+    CheckErrors(Address());
+    NS_TEST_ASSERT_MSG_EQ(m_ctrlFrames.size(), 2, "the lost routes weren't rediscovered");
+
+    // the packets arriving during the repair wait for it
+    Simulator::Schedule(Seconds(0.1),
+                        &CognitiveRoutingUnite::ReceiveFrame,
+                        head,
+                        MakeData(lost, m_precursor, node));
+    Simulator::Schedule(Seconds(0.2),
+                        &CognitiveRoutingUnite::ReceiveRouteReply,
+                        head,
+                        MakeReply(repaired, alternative, 0.01));
+    Simulator::Schedule(Seconds(0.4), &CognitiveLocalRepairTestCase::CheckErrors, this, Address());
+
+    // the repair that found no route reports it and drops its packets
+    Simulator::Schedule(Seconds(0.6), &CognitiveLocalRepairTestCase::CheckErrors, this, lost);
+    Simulator::Schedule(Seconds(0.7),
+                        &CognitiveRoutingUnite::ReceiveFrame,
+                        head,
+                        MakeData(repaired, m_precursor, node));
+    Simulator::Stop(Seconds(1));
+    Simulator::Run();
+
+    NS_TEST_ASSERT_MSG_EQ(m_drops, 1, "the packet of the failed repair wasn't dropped");
+    NS_TEST_ASSERT_MSG_EQ(m_dataFrames.size(), 4, "the repaired route didn't carry the packets");
+    NS_TEST_ASSERT_MSG_EQ(Address(m_dataFrames[2]->GetCurrentReceiver()),
+                          alternative,
+                          "the salvaged packet didn't take the repaired route");
+    NS_TEST_ASSERT_MSG_EQ(Address(m_dataFrames[3]->GetCurrentReceiver()),
+                          alternative,
+                          "the packet didn't take the repaired route");
+
+    head->Dispose();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Members of a cluster two cluster hops away
+ * resolved through the distance vectors
+ */
+class CognitiveClusterMembersTestCase : public CognitiveRoutingTestCase
+{
+  public:
+    CognitiveClusterMembersTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * The members of the far cluster
+     * @return the members
+     */
+    std::vector<Address> GetMembers();
+
+    /**
+     * Hand the vectors sent so far to the neighboring
+     * cluster heads of their sender, the heads are in a line
+     */
+    void Deliver();
+
+    Address m_member;                                 //!< the member of the far cluster
+    std::vector<Address> m_addresses;                 //!< the addresses of the cluster heads
+    std::vector<Ptr<CognitiveRoutingUnite>> m_heads; //!< the cluster heads in a line
+};
+
+CognitiveClusterMembersTestCase::CognitiveClusterMembersTestCase()
+    : CognitiveRoutingTestCase("Cluster members beyond the neighboring clusters"),
+      m_member(Mac48Address("00:00:00:00:00:0c"))
+{
+}
+
+std::vector<Address>
+CognitiveClusterMembersTestCase::GetMembers()
+{
+    return {m_member};
+}
+
+void
+CognitiveClusterMembersTestCase::Deliver()
+{
+    std::vector<Ptr<MacDcfFrame>> frames;
+    frames.swap(m_ctrlFrames);
+    for (auto& frame : frames)
+    {
+        for (uint32_t i = 0; i < m_heads.size(); i++)
+        {
+            if (Address(frame->GetCurrentSender()) != m_addresses[i])
+            {
+                continue;
+            }
+            if (i > 0)
+            {
+                m_heads[i - 1]->ReceiveFrame(frame);
+            }
+            if (i + 1 < m_heads.size())
+            {
+                m_heads[i + 1]->ReceiveFrame(frame);
+            }
+        }
+    }
+}
+
+void
+CognitiveClusterMembersTestCase::DoRun()
+{
+    Address a = Mac48Address("00:00:00:00:00:01");
+    Address b = Mac48Address("00:00:00:00:00:02");
+    Address c = Mac48Address("00:00:00:00:00:03");
+
+    // three cluster heads in a line, only the far one knows the member
+    m_addresses = {a, b, c};
+    for (auto& address : m_addresses)
+    {
+        m_heads.push_back(CreateRoutingUnite(address));
+    }
+    m_heads[2]->SetClusterMembersCallback(
+        MakeCallback(&CognitiveClusterMembersTestCase::GetMembers, this));
+    for (auto& head : m_heads)
+    {
+        head->SetAttribute("ProactiveMode", BooleanValue(true));
+        head->SetAttribute("ClusterVectorPeriod", TimeValue(Seconds(0.1)));
+        head->SetClusterHeadStatus(true);
+    }
+    for (uint32_t i = 1; i < 10; i++)
+    {
+        Simulator::Schedule(Seconds(0.05 * i), &CognitiveClusterMembersTestCase::Deliver, this);
+    }
+    Simulator::Schedule(Seconds(0.52),
+                        &CognitiveRoutingUnite::SendPacket,
+                        m_heads[0],
+                        Create<Packet>(100),
+                        a,
+                        m_member,
+                        uint16_t(1));
+    Simulator::Stop(Seconds(0.55));
+    Simulator::Run();
+
+    NS_TEST_ASSERT_MSG_EQ(m_dataFrames.size(), 1, "the far member wasn't resolved");
+    NS_TEST_ASSERT_MSG_EQ(Address(m_dataFrames[0]->GetCurrentReceiver()),
+                          b,
+                          "the packet didn't go towards the cluster of the member");
+    for (auto& frame : m_ctrlFrames)
+    {
+        NS_TEST_ASSERT_MSG_NE(frame->GetMsgType(),
+                              RoutingMsgType::RReq,
+                              "the far member needed a route discovery");
+    }
+
+    for (auto& head : m_heads)
+    {
+        head->Dispose();
+    }
+    m_heads.clear();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Block acknowledgement of the aggregated subframes
+ */
+class CognitiveBlockAckTestCase : public TestCase
+{
+  public:
+    CognitiveBlockAckTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+CognitiveBlockAckTestCase::CognitiveBlockAckTestCase()
+    : TestCase("A-MPDU block ack and retransmission of the missing subframes")
+{
+}
+
+void
+CognitiveBlockAckTestCase::DoRun()
+{
+    std::vector<Ptr<MacDcfFrame>> subframes;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        subframes.push_back(CreateObject<MacDcfFrame>());
+        subframes.back()->SetPacket(Create<Packet>(100));
+    }
+    Ptr<MacDcfFrame> ampdu = CreateObject<MacDcfFrame>();
+    ampdu->SetAggregate(subframes);
+    NS_TEST_ASSERT_MSG_EQ(ampdu->IsAggregate(), true, "the aggregate wasn't kept");
+    NS_TEST_ASSERT_MSG_EQ(ampdu->GetAggregate().size(), 4, "the subframes weren't kept");
+
+    // the subframes marked in the bitmap are done, the others go again in their order
+    Ptr<MacDcfFrame> ack = CreateObject<MacDcfFrame>();
+    ack->SetBlockAck({true, false, true});
+    std::vector<Ptr<MacDcfFrame>> acked;
+    std::vector<Ptr<MacDcfFrame>> missing;
+    CognitiveGeneralNetDevice::SplitBlockAck(subframes, ack->GetBlockAck(), acked, missing);
+    NS_TEST_ASSERT_MSG_EQ(acked.size(), 2, "wrong number of acknowledged subframes");
+    NS_TEST_ASSERT_MSG_EQ(acked[0], subframes[0], "the wrong subframe was acknowledged");
+    NS_TEST_ASSERT_MSG_EQ(acked[1], subframes[2], "the wrong subframe was acknowledged");
+    NS_TEST_ASSERT_MSG_EQ(missing.size(), 2, "wrong number of missing subframes");
+    NS_TEST_ASSERT_MSG_EQ(missing[0], subframes[1], "the missing subframes were reordered");
+    NS_TEST_ASSERT_MSG_EQ(missing[1], subframes[3], "a subframe beyond the bitmap wasn't missing");
+
+    // a full bitmap completes the exchange
+    acked.clear();
+    missing.clear();
+    CognitiveGeneralNetDevice::SplitBlockAck(subframes, {true, true, true, true}, acked, missing);
+    NS_TEST_ASSERT_MSG_EQ(missing.empty(), true, "a subframe acknowledged was sent again");
+
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Virtual carrier sense by the NAV
+ */
+class CognitiveNavTestCase : public TestCase
+{
+  public:
+    CognitiveNavTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Check the virtual carrier sense of a device
+     * @param device the device
+     * @param busy true if the NAV must be set
+     */
+    void CheckNav(Ptr<CognitiveGeneralNetDevice> device, bool busy);
+};
+
+CognitiveNavTestCase::CognitiveNavTestCase()
+    : TestCase("NAV updates and expiry")
+{
+}
+
+void
+CognitiveNavTestCase::CheckNav(Ptr<CognitiveGeneralNetDevice> device, bool busy)
+{
+    NS_TEST_ASSERT_MSG_EQ(device->IsNavBusy(), busy, "wrong NAV at " << Simulator::Now());
+}
+
+void
+CognitiveNavTestCase::DoRun()
+{
+    Ptr<CognitiveGeneralNetDevice> device = CreateObject<CognitiveGeneralNetDevice>();
+    NS_TEST_ASSERT_MSG_EQ(device->IsNavBusy(), false, "the NAV is set without a frame");
+
+    // the NAV holds for the duration of the overheard frame
+    device->UpdateNav(MilliSeconds(10));
+    Simulator::Schedule(MilliSeconds(5), &CognitiveNavTestCase::CheckNav, this, device, true);
+
+    // a shorter duration doesn't cut the NAV, a longer one extends it
+    Simulator::Schedule(MilliSeconds(5),
+                        &CognitiveGeneralNetDevice::UpdateNav,
+                        device,
+                        MilliSeconds(2));
+    Simulator::Schedule(MilliSeconds(8), &CognitiveNavTestCase::CheckNav, this, device, true);
+    Simulator::Schedule(MilliSeconds(9),
+                        &CognitiveGeneralNetDevice::UpdateNav,
+                        device,
+                        MilliSeconds(10));
+    Simulator::Schedule(MilliSeconds(15), &CognitiveNavTestCase::CheckNav, this, device, true);
+    Simulator::Schedule(MilliSeconds(19), &CognitiveNavTestCase::CheckNav, this, device, false);
+
+    // a reservation heard in the old cluster doesn't hold in the new one
+    Simulator::Schedule(MilliSeconds(20),
+                        &CognitiveGeneralNetDevice::UpdateNav,
+                        device,
+                        MilliSeconds(10));
+    Simulator::Schedule(MilliSeconds(21),
+                        &CognitiveGeneralNetDevice::SetClusterInfo,
+                        device,
+                        uint16_t(1),
+                        uint16_t(2),
+                        Address(Mac48Address("00:00:00:00:00:01")));
+    Simulator::Schedule(MilliSeconds(22), &CognitiveNavTestCase::CheckNav, this, device, false);
+    Simulator::Run();
+
+    device->Dispose();
+    Simulator::Destroy();
+}
+
+/**
+ * @ingroup cognitive-mac-tests
+ * Choice of the data channel in the multi-channel mode
+ */
+class CognitiveMultiChannelTestCase : public TestCase
+{
+  public:
+    CognitiveMultiChannelTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Check the data channel chosen by a device
+     * @param device the device
+     * @param channel the expected channel
+     */
+    void CheckChannel(Ptr<CognitiveGeneralNetDevice> device, uint16_t channel);
+};
+
+CognitiveMultiChannelTestCase::CognitiveMultiChannelTestCase()
+    : TestCase("Multi-channel choice between the CADC and the CBDC")
+{
+}
+
+void
+CognitiveMultiChannelTestCase::CheckChannel(Ptr<CognitiveGeneralNetDevice> device, uint16_t channel)
+{
+    NS_TEST_ASSERT_MSG_EQ(device->ChooseDataChannel(),
+                          channel,
+                          "wrong data channel at " << Simulator::Now());
+}
+
+void
+CognitiveMultiChannelTestCase::DoRun()
+{
+    Address head = Mac48Address("00:00:00:00:00:01");
+    Ptr<CognitiveGeneralNetDevice> device = CreateObject<CognitiveGeneralNetDevice>();
+    device->SetDeviceKind(true);
+    device->SetClusterInfo(1, 2, head);
+
+    // without the mode every exchange stays on the common channel
+    CheckChannel(device, 1);
+    device->SetAttribute("MultiChannel", BooleanValue(true));
+    CheckChannel(device, 2);
+
+    // an overheard exchange on the backup channel sends the next ones to the common one
+    device->ReserveChannel(2, MilliSeconds(10));
+    NS_TEST_ASSERT_MSG_EQ(device->IsChannelReserved(2), true, "the reservation wasn't kept");
+    CheckChannel(device, 1);
+    device->ReserveChannel(1, MilliSeconds(10));
+    NS_TEST_ASSERT_MSG_EQ(device->IsChannelReserved(1), false, "the common channel was reserved");
+    Simulator::Schedule(MilliSeconds(5),
+                        &CognitiveMultiChannelTestCase::CheckChannel,
+                        this,
+                        device,
+                        uint16_t(1));
+    Simulator::Schedule(MilliSeconds(10),
+                        &CognitiveMultiChannelTestCase::CheckChannel,
+                        this,
+                        device,
+                        uint16_t(2));
+    Simulator::Run();
+
+    // a new cluster drops the reservations heard in the old one
+    device->ReserveChannel(2, MilliSeconds(10));
+    device->SetClusterInfo(3, 2, head);
+    CheckChannel(device, 2);
+
+    // a cluster without a backup channel and the control device use the common channel
+    device->SetClusterInfo(3, 3, head);
+    CheckChannel(device, 3);
+    device->SetClusterInfo(3, 2, head);
+    device->SetDeviceKind(false);
+    CheckChannel(device, 3);
+
+    device->Dispose();
+    Simulator::Destroy();
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -76,6 +1716,24 @@ CognitiveMacTestSuite::CognitiveMacTestSuite()
 {
     // Duration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
     AddTestCase(new CognitiveMacTestCase1, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveChannelIndexTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveNcciHeaderTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveMacKeyTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveDuplicateCacheTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveMacQueueTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveClusterHysteresisTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveNcciRefreshTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveDcfRetryTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveClusterVectorTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitivePendingQueueTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveRouteRefreshTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveLinkDelayTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveMultipathTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveLocalRepairTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveClusterMembersTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveBlockAckTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveNavTestCase, TestCase::Duration::QUICK);
+    AddTestCase(new CognitiveMultiChannelTestCase, TestCase::Duration::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite